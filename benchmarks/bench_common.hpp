@@ -0,0 +1,42 @@
+#ifndef SJTU_BENCH_COMMON_HPP
+#define SJTU_BENCH_COMMON_HPP
+
+// Timing helpers shared by the benchmarks. Each one runs f and returns the
+// wall time it took on the steady clock.
+
+#include <chrono>
+
+namespace bench {
+
+template <class Duration, class F> double elapsed(F &f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, typename Duration::period>(stop - start)
+      .count();
+}
+
+template <class F> double time_ns(F f) {
+  return elapsed<std::chrono::nanoseconds>(f);
+}
+
+template <class F> double time_us(F f) {
+  return elapsed<std::chrono::microseconds>(f);
+}
+
+template <class F> double time_ms(F f) {
+  return elapsed<std::chrono::milliseconds>(f);
+}
+
+// Mean milliseconds over reps calls of f
+template <class F> double time_ms(F f, int reps) {
+  return time_ms([&] {
+           for (int i = 0; i < reps; ++i)
+             f();
+         }) /
+         reps;
+}
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,102 @@
+// Compare the block sizing policies of sjtu::deque.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -I. benchmarks/block_policy.cpp -o block_policy
+#include "bench_common.hpp"
+#include "deque.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+
+struct payload {
+  long words[32]; // 256 bytes
+  payload(long v = 0) { words[0] = v; }
+  bool operator<(const payload &rhs) const { return words[0] < rhs.words[0]; }
+};
+
+long value_of(long v) { return v; }
+long value_of(const payload &p) { return p.words[0]; }
+
+volatile long sink;
+
+using bench::time_ms;
+
+template <class T, class Policy> void run(const char *name, size_t n) {
+  typedef sjtu::deque<T, std::allocator<T>, Policy> deque_type;
+  deque_type d;
+
+  double push = time_ms([&] {
+    for (size_t i = 0; i < n; ++i) {
+      if (i & 1)
+        d.push_back(T(i));
+      else
+        d.push_front(T(i));
+    }
+  });
+
+  double access = time_ms([&] {
+    long sum = 0;
+    size_t pos = 12345;
+    for (size_t i = 0; i < n; ++i) {
+      pos = (pos * 1103515245 + 12345) % d.size();
+      sum += value_of(d[pos]);
+    }
+    sink = sum;
+  });
+
+  double iterate = time_ms([&] {
+    long sum = 0;
+    for (auto it = d.begin(); it != d.end(); ++it)
+      sum += value_of(*it);
+    sink = sum;
+  });
+
+  size_t inserts = n / 100;
+  double insert = time_ms([&] {
+    size_t pos = 777;
+    for (size_t i = 0; i < inserts; ++i) {
+      pos = (pos * 1103515245 + 12345) % d.size();
+      d.insert(d.begin() + pos, T(i));
+    }
+  });
+
+  double churn = time_ms([&] {
+    for (size_t i = 0; i < n; ++i) {
+      d.push_back(T(i));
+      d.pop_front();
+    }
+  });
+
+  double pop = time_ms([&] {
+    while (!d.empty()) {
+      d.pop_back();
+      if (!d.empty())
+        d.pop_front();
+    }
+  });
+
+  std::printf("%-12s %-16s %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", name,
+              sizeof(T) == sizeof(long) ? "long" : "payload(256B)", push,
+              access, iterate, insert, churn, pop);
+}
+
+template <class T> void run_all(size_t n) {
+  run<T, sjtu::sqrt_block_policy>("sqrt", n);
+  run<T, sjtu::fixed_bytes_block_policy<1024>>("fixed-1K", n);
+  run<T, sjtu::page_block_policy>("page-4K", n);
+  run<T, sjtu::fixed_bytes_block_policy<65536>>("fixed-64K", n);
+  run<T, sjtu::cache_line_block_policy<>>("cacheline-64", n);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  std::printf("n = %zu, times in ms\n", n);
+  std::printf("%-12s %-16s %9s %9s %9s %9s %9s %9s\n", "policy", "element",
+              "push", "random[]", "iterate", "insert", "churn", "pop");
+  run_all<long>(n);
+  run_all<payload>(n / 8);
+  return 0;
+}
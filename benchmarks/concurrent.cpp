@@ -0,0 +1,127 @@
+// MPMC throughput of concurrent_deque against one mutex around sjtu::deque:
+// producers push at the back and consumers pop at the front, each thread
+// pinned to its own CPU where the platform allows.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -pthread -I. benchmarks/concurrent.cpp -o concurrent
+// Usage: concurrent [items per producer] [max producers]
+#include "bench_common.hpp"
+#include "concurrent_deque.hpp"
+#include "deque.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+using bench::time_us;
+
+class locked_deque {
+private:
+  std::mutex lock;
+  sjtu::deque<long> items;
+
+public:
+  void push_back(long x) {
+    std::lock_guard<std::mutex> guard(lock);
+    items.push_back(x);
+  }
+  bool try_pop_front(long &x) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (items.empty())
+      return false;
+    x = items.front();
+    items.pop_front();
+    return true;
+  }
+};
+
+void pin(std::thread &t, size_t cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % std::thread::hardware_concurrency(), &set);
+  pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+  (void)t;
+  (void)cpu;
+#endif
+}
+
+// Millions of items per second moved from producers to consumers
+template <class Queue> double run(size_t per_producer, size_t threads) {
+  Queue q;
+  std::atomic<size_t> producing(threads);
+  std::atomic<long> checksum(0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> pool;
+  for (size_t p = 0; p < threads; ++p) {
+    pool.emplace_back([&] {
+      while (!go.load())
+        ;
+      for (size_t i = 0; i < per_producer; ++i)
+        q.push_back(long(i));
+      producing.fetch_sub(1);
+    });
+    pin(pool.back(), 2 * p);
+  }
+  for (size_t c = 0; c < threads; ++c) {
+    pool.emplace_back([&] {
+      while (!go.load())
+        ;
+      long x, sum = 0;
+      for (;;) {
+        bool finished = producing.load() == 0;
+        if (q.try_pop_front(x))
+          sum += x;
+        else if (finished)
+          break;
+      }
+      checksum.fetch_add(sum);
+    });
+    pin(pool.back(), 2 * c + 1);
+  }
+
+  double us = time_us([&] {
+    go.store(true);
+    for (auto &t : pool)
+      t.join();
+  });
+
+  long expect = long(threads) * long(per_producer) * long(per_producer - 1) / 2;
+  if (checksum.load() != expect)
+    std::printf("checksum mismatch\n");
+  return threads * per_producer / us;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t per_producer = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+  size_t max_pairs = std::thread::hardware_concurrency() / 2;
+  if (argc > 2)
+    max_pairs = std::strtoul(argv[2], nullptr, 10);
+  if (max_pairs == 0)
+    max_pairs = 1;
+
+  std::printf("%zu items per producer, millions of items per second\n",
+              per_producer);
+  std::printf("%20s %16s %18s\n", "producers/consumers", "mutex + deque",
+              "concurrent_deque");
+  for (size_t pairs = 1;; pairs *= 2) {
+    if (pairs > max_pairs)
+      pairs = max_pairs;
+    std::printf("%18zu/%zu %16.2f %18.2f\n", pairs, pairs,
+                run<locked_deque>(per_producer, pairs),
+                run<sjtu::concurrent_deque<long>>(per_producer, pairs));
+    if (pairs == max_pairs)
+      break;
+  }
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Push/pop oscillation at a block boundary, the producer/consumer pattern
+// that used to allocate and free an end block on every cycle.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -I. benchmarks/oscillation.cpp -o oscillation
+#include "bench_common.hpp"
+#include "deque.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+
+namespace {
+
+size_t allocations = 0;
+
+// std::allocator that counts allocate calls
+template <class T> struct counting_allocator : std::allocator<T> {
+  typedef T value_type;
+  template <class U> struct rebind {
+    typedef counting_allocator<U> other;
+  };
+
+  counting_allocator() {}
+  template <class U> counting_allocator(const counting_allocator<U> &) {}
+
+  T *allocate(size_t n) {
+    ++allocations;
+    return std::allocator<T>::allocate(n);
+  }
+};
+
+template <class T, class U>
+bool operator==(const counting_allocator<T> &, const counting_allocator<U> &) {
+  return true;
+}
+template <class T, class U>
+bool operator!=(const counting_allocator<T> &, const counting_allocator<U> &) {
+  return false;
+}
+
+using bench::time_ms;
+
+void report(const char *name, size_t cycles, double ms, size_t allocs) {
+  std::printf("%-34s %10.2f %12.2f %14.4f\n", name, ms, ms * 1e6 / cycles,
+              double(allocs) / cycles);
+}
+
+// Fill d until the back block is exactly full: pushing one more element
+// opens a new block, which shows up as an allocation
+template <class Deque> void fill_to_back_boundary(Deque &d, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    d.push_back(long(i));
+  size_t before = allocations;
+  while (allocations == before)
+    d.push_back(0);
+  d.pop_back();
+}
+
+template <class Deque> void fill_to_front_boundary(Deque &d, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    d.push_front(long(i));
+  size_t before = allocations;
+  while (allocations == before)
+    d.push_front(0);
+  d.pop_front();
+}
+
+template <class Deque>
+void run(const char *back_name, const char *front_name, size_t n,
+         size_t cycles) {
+  {
+    Deque d;
+    fill_to_back_boundary(d, n);
+    size_t before = allocations;
+    double ms = time_ms([&] {
+      for (size_t i = 0; i < cycles; ++i) {
+        d.push_back(long(i));
+        d.pop_back();
+      }
+    });
+    report(back_name, cycles, ms, allocations - before);
+  }
+  {
+    Deque d;
+    fill_to_front_boundary(d, n);
+    size_t before = allocations;
+    double ms = time_ms([&] {
+      for (size_t i = 0; i < cycles; ++i) {
+        d.push_front(long(i));
+        d.pop_front();
+      }
+    });
+    report(front_name, cycles, ms, allocations - before);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  size_t cycles = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000000;
+  std::printf("n = %zu, %zu push/pop cycles at a full end block\n", n, cycles);
+  std::printf("%-34s %10s %12s %14s\n", "container", "total ms", "ns/cycle",
+              "allocs/cycle");
+
+  typedef counting_allocator<long> alloc;
+  run<sjtu::deque<long, alloc>>("sjtu::deque (sqrt) back",
+                                "sjtu::deque (sqrt) front", n, cycles);
+  run<sjtu::deque<long, alloc, sjtu::page_block_policy>>(
+      "sjtu::deque (page) back", "sjtu::deque (page) front", n, cycles);
+  run<std::deque<long, alloc>>("std::deque back", "std::deque front", n,
+                               cycles);
+  return 0;
+}
@@ -0,0 +1,72 @@
+// Scaling of parallel_for_each, parallel_transform and parallel_reduce from
+// one thread to every hardware thread.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -pthread -I. benchmarks/parallel.cpp -o parallel
+#include "bench_common.hpp"
+#include "deque_parallel.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+volatile double sink;
+
+using bench::time_ms;
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000000;
+  size_t max_threads = std::thread::hardware_concurrency();
+  if (argc > 2)
+    max_threads = std::strtoul(argv[2], nullptr, 10);
+  if (max_threads == 0)
+    max_threads = 1;
+
+  sjtu::deque<double> d;
+  for (size_t i = 0; i < n; ++i)
+    d.push_back(double(i % 1000) / 7);
+  std::vector<double> out(n);
+
+  std::printf("n = %zu doubles, ms per call (speedup over 1 thread)\n", n);
+  std::printf("%8s %20s %20s %20s\n", "threads", "for_each", "transform",
+              "reduce");
+
+  double base[3] = {0, 0, 0};
+  for (size_t threads = 1;; threads *= 2) {
+    if (threads > max_threads)
+      threads = max_threads;
+    sjtu::work_stealing_pool pool(threads);
+
+    double t[3];
+    t[0] = time_ms([&] {
+      sjtu::parallel_for_each(pool, d, [](double &x) {
+        x = std::sqrt(x * x + 1.0) - 1.0 + x * 1e-9;
+      });
+    });
+    t[1] = time_ms([&] {
+      sjtu::parallel_transform(pool, static_cast<const sjtu::deque<double> &>(d),
+                               out.begin(),
+                               [](double x) { return std::sin(x) * 0.5; });
+    });
+    t[2] = time_ms([&] {
+      sink = sjtu::parallel_reduce(
+          pool, d, 0.0, [](double a, double b) { return a + b; });
+    });
+
+    if (threads == 1)
+      for (int i = 0; i < 3; ++i)
+        base[i] = t[i];
+    std::printf("%8zu", threads);
+    for (int i = 0; i < 3; ++i)
+      std::printf(" %12.2f (%4.1fx)", t[i], base[i] / t[i]);
+    std::printf("\n");
+
+    if (threads == max_threads)
+      break;
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+// Startup cost of persistent_deque against rebuilding a sjtu::deque from a
+// flat file of records, plus append throughput in both durability modes.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -I. benchmarks/persistent.cpp -o persistent
+// Usage: persistent [records] [directory for the files]
+#include "bench_common.hpp"
+#include "deque.hpp"
+#include "persistent_deque.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// Fixed-size record: a key plus a small payload
+struct record {
+  long key;
+  long payload;
+};
+
+volatile long sink;
+
+using bench::time_ms;
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  std::string dir = argc > 2 ? argv[2] : ".";
+  std::string flat = dir + "/persistent_bench.flat";
+  std::string mapped = dir + "/persistent_bench.pdq";
+  typedef sjtu::persistent_deque<record> pdeque;
+  std::printf("n = %zu records of %zu bytes, ms\n", n, sizeof(record));
+
+  unlink(flat.c_str());
+  unlink(mapped.c_str());
+  double t = time_ms([&] {
+    std::FILE *f = std::fopen(flat.c_str(), "wb");
+    for (size_t i = 0; i < n; ++i) {
+      record r{long(i), long(i) * 3};
+      std::fwrite(&r, sizeof(r), 1, f);
+    }
+    std::fclose(f);
+  });
+  std::printf("%-44s %10.1f\n", "write flat file", t);
+  t = time_ms([&] {
+    pdeque d(mapped.c_str());
+    for (size_t i = 0; i < n; ++i)
+      d.push_back(record{long(i), long(i) * 3});
+    d.sync();
+  });
+  std::printf("%-44s %10.1f\n", "build persistent_deque (deferred)", t);
+
+  t = time_ms([&] {
+    sjtu::deque<record> d;
+    std::FILE *f = std::fopen(flat.c_str(), "rb");
+    record r;
+    while (std::fread(&r, sizeof(r), 1, f) == 1)
+      d.push_back(r);
+    std::fclose(f);
+    sink = d[d.size() / 2].key;
+  });
+  std::printf("%-44s %10.1f\n", "startup: rebuild sjtu::deque from flat file",
+              t);
+  t = time_ms([&] {
+    pdeque d(mapped.c_str());
+    sink = d[d.size() / 2].key;
+  });
+  std::printf("%-44s %10.3f\n", "startup: reopen persistent_deque", t);
+
+  size_t appends = 1000;
+  pdeque s(mapped.c_str(), pdeque::durability::synchronous);
+  t = time_ms([&] {
+    for (size_t i = 0; i < appends; ++i) {
+      s.push_back(record{long(i), 0});
+      s.pop_front();
+    }
+  });
+  std::printf("%-44s %10.3f\n", "push_back + pop_front, synchronous (per op)",
+              t / appends);
+
+  unlink(flat.c_str());
+  unlink(mapped.c_str());
+  return 0;
+}
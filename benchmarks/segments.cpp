@@ -0,0 +1,67 @@
+// Iterator loops versus the segmented algorithms of deque_algorithm.hpp.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -I. benchmarks/segments.cpp -o segments
+#include "bench_common.hpp"
+#include "deque_algorithm.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+volatile long sink;
+
+using bench::time_ms;
+
+void report(const char *name, double iter_ms, double seg_ms) {
+  std::printf("%-12s %12.3f %12.3f %9.1fx\n", name, iter_ms, seg_ms,
+              iter_ms / seg_ms);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4000000;
+  int reps = 20;
+  sjtu::deque<int> d;
+  for (size_t i = 0; i < n; ++i) {
+    if (i & 1)
+      d.push_back(int(i));
+    else
+      d.push_front(int(i));
+  }
+  std::vector<int> out(n);
+
+  std::printf("n = %zu ints, ms per pass\n", n);
+  std::printf("%-12s %12s %12s %10s\n", "algorithm", "iterator", "segmented",
+              "speedup");
+
+  report(
+      "accumulate",
+      time_ms([&] { sink = std::accumulate(d.begin(), d.end(), 0L); }, reps),
+      time_ms([&] { sink = sjtu::accumulate(d, 0L); }, reps));
+
+  report("for_each",
+         time_ms(
+             [&] {
+               std::for_each(d.begin(), d.end(), [](int &x) { x += 1; });
+             },
+             reps),
+         time_ms([&] { sjtu::for_each(d, [](int &x) { x -= 1; }); }, reps));
+
+  report("copy",
+         time_ms([&] { std::copy(d.begin(), d.end(), out.begin()); }, reps),
+         time_ms([&] { sjtu::copy(d, out.begin()); }, reps));
+
+  report("fill", time_ms([&] { std::fill(d.begin(), d.end(), 7); }, reps),
+         time_ms([&] { sjtu::fill(d, 7); }, reps));
+
+  d.back() = 42;
+  report("find",
+         time_ms([&] { sink = std::find(d.begin(), d.end(), 42) - d.begin(); },
+                 reps),
+         time_ms([&] { sink = sjtu::find(d, 42) - d.begin(); }, reps));
+  return 0;
+}
@@ -0,0 +1,87 @@
+// sjtu::sort and sjtu::stable_sort against std::sort on std::vector and
+// std::deque, from one thread to every hardware thread.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -pthread -I. benchmarks/sort.cpp -o sort
+#include "bench_common.hpp"
+#include "deque_sort.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Int-like record: a key plus a small payload
+struct record {
+  int key;
+  int payload;
+};
+
+bool by_key(const record &a, const record &b) { return a.key < b.key; }
+
+using bench::time_ms;
+
+template <class Container> void fill(Container &c, size_t n) {
+  std::mt19937 rng(12345);
+  for (size_t i = 0; i < n; ++i)
+    c.push_back(record{int(rng() % 1000000), int(i)});
+}
+
+template <class Deque> bool sorted(const Deque &d) {
+  for (size_t i = 1; i < d.size(); ++i)
+    if (by_key(d[i], d[i - 1]))
+      return false;
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  size_t max_threads = std::thread::hardware_concurrency();
+  if (argc > 2)
+    max_threads = std::strtoul(argv[2], nullptr, 10);
+  if (max_threads == 0)
+    max_threads = 1;
+  std::printf("n = %zu records, ms per sort\n", n);
+
+  {
+    std::vector<record> v;
+    fill(v, n);
+    std::printf("%-28s %10.1f\n", "std::sort (std::vector)",
+                time_ms([&] { std::sort(v.begin(), v.end(), by_key); }));
+  }
+  {
+    std::deque<record> d;
+    fill(d, n);
+    std::printf("%-28s %10.1f\n", "std::sort (std::deque)",
+                time_ms([&] { std::sort(d.begin(), d.end(), by_key); }));
+  }
+
+  for (size_t threads = 1;; threads *= 2) {
+    if (threads > max_threads)
+      threads = max_threads;
+    sjtu::work_stealing_pool pool(threads);
+    char name[64];
+
+    sjtu::deque<record> d;
+    fill(d, n);
+    std::snprintf(name, sizeof(name), "sjtu::sort, %zu threads", threads);
+    double t = time_ms([&] { sjtu::sort(pool, d, by_key); });
+    std::printf("%-28s %10.1f%s\n", name, t, sorted(d) ? "" : "  NOT SORTED");
+
+    sjtu::deque<record> s;
+    fill(s, n);
+    std::snprintf(name, sizeof(name), "sjtu::stable_sort, %zu threads",
+                  threads);
+    t = time_ms([&] { sjtu::stable_sort(pool, s, by_key); });
+    std::printf("%-28s %10.1f%s\n", name, t, sorted(s) ? "" : "  NOT SORTED");
+
+    if (threads == max_threads)
+      break;
+  }
+  return 0;
+}
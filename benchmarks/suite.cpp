@@ -0,0 +1,309 @@
+// Every deque operation against std::deque across sizes, with warmup,
+// repeated runs and percentiles, written as JSON for regression tracking.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -I. benchmarks/suite.cpp -o suite
+// Usage: suite [--min N] [--max N] [--reps R] [--json FILE]
+// Sizes go from --min to --max in powers of ten (default 1e3 to 1e7; 1e8
+// needs about 2 GB). A table of medians goes to stdout, and the JSON goes
+// to FILE, or to stdout instead of the table when FILE is "-".
+#include "bench_common.hpp"
+#include "deque.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+volatile long sink;
+
+// Each repetition does at least this many element operations, spread over
+// several containers when n is small, so short runs are still timeable
+const size_t min_ops = 1000000;
+
+enum operation {
+  push_back_op,
+  push_front_op,
+  pop_back_op,
+  pop_front_op,
+  random_index_op,
+  iterator_jump_op,
+  middle_insert_op,
+  middle_erase_op,
+  copy_op,
+  operation_count
+};
+
+const char *operation_names[operation_count] = {
+    "push_back",     "push_front",    "pop_back",
+    "pop_front",     "random_index",  "iterator_jump",
+    "middle_insert", "middle_erase",  "copy"};
+
+struct summary {
+  double min, p50, p90, p99, max, mean;
+};
+
+struct result {
+  const char *container;
+  operation op;
+  size_t size;
+  size_t ops; // Operations per repetition
+  summary ns_per_op;
+};
+
+// Nearest-rank percentile of sorted samples
+double percentile(const std::vector<double> &sorted, double p) {
+  size_t rank = (size_t)(p / 100 * sorted.size() + 0.999999);
+  if (rank == 0)
+    rank = 1;
+  if (rank > sorted.size())
+    rank = sorted.size();
+  return sorted[rank - 1];
+}
+
+summary summarize(std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  double total = 0;
+  for (double s : samples)
+    total += s;
+  return {samples.front(),         percentile(samples, 50),
+          percentile(samples, 90), percentile(samples, 99),
+          samples.back(),          total / samples.size()};
+}
+
+using bench::time_ns;
+
+template <class D> void fill(D &d, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    d.push_back(int(i));
+}
+
+// Inserts or erases per container in the middle operations; std::deque
+// moves O(n) elements for each, so fewer are done as n grows
+size_t middle_ops(size_t n) {
+  size_t k = std::min<size_t>(10000000 / n, std::min<size_t>(n / 2, 1000));
+  return std::max<size_t>(1, k);
+}
+
+/**
+ * One repetition of op at size n. Setup and teardown are not timed.
+ * @return Nanoseconds per operation; ops is set to the operations timed
+ */
+template <class D>
+double run_once(operation op, size_t n, std::mt19937_64 &rng, size_t &ops) {
+  size_t rounds = std::max<size_t>(1, min_ops / n);
+  std::vector<D> ds(rounds);
+  std::vector<size_t> picks;
+  double ns = 0;
+  long sum = 0;
+
+  switch (op) {
+  case push_back_op:
+    ops = rounds * n;
+    ns = time_ns([&] {
+      for (D &d : ds)
+        for (size_t i = 0; i < n; ++i)
+          d.push_back(int(i));
+    });
+    break;
+  case push_front_op:
+    ops = rounds * n;
+    ns = time_ns([&] {
+      for (D &d : ds)
+        for (size_t i = 0; i < n; ++i)
+          d.push_front(int(i));
+    });
+    break;
+  case pop_back_op:
+    ops = rounds * n;
+    for (D &d : ds)
+      fill(d, n);
+    ns = time_ns([&] {
+      for (D &d : ds)
+        for (size_t i = 0; i < n; ++i)
+          d.pop_back();
+    });
+    break;
+  case pop_front_op:
+    ops = rounds * n;
+    for (D &d : ds)
+      fill(d, n);
+    ns = time_ns([&] {
+      for (D &d : ds)
+        for (size_t i = 0; i < n; ++i)
+          d.pop_front();
+    });
+    break;
+  case random_index_op:
+  case iterator_jump_op: {
+    // Lookups do not change the container, so one is enough
+    ds.resize(1);
+    fill(ds[0], n);
+    ops = std::max(n, min_ops);
+    picks.resize(ops);
+    std::uniform_int_distribution<size_t> pos(0, n - 1);
+    for (size_t &p : picks)
+      p = pos(rng);
+    D &d = ds[0];
+    if (op == random_index_op) {
+      ns = time_ns([&] {
+        for (size_t p : picks)
+          sum += d[p];
+      });
+    } else {
+      auto first = d.begin();
+      ns = time_ns([&] {
+        for (size_t p : picks)
+          sum += *(first + long(p));
+      });
+    }
+    break;
+  }
+  case middle_insert_op:
+  case middle_erase_op: {
+    size_t k = middle_ops(n);
+    rounds = std::max<size_t>(1, min_ops / 100 / k);
+    rounds = std::min(rounds, std::max<size_t>(1, min_ops / n));
+    ds.resize(rounds);
+    for (D &d : ds)
+      fill(d, n);
+    ops = rounds * k;
+    // Positions within the middle half, drawn before timing
+    picks.resize(ops);
+    for (size_t i = 0; i < ops; ++i) {
+      size_t len = op == middle_insert_op ? n + i % k : n - i % k;
+      picks[i] = len / 4 + rng() % (len / 2 + 1);
+    }
+    if (op == middle_insert_op) {
+      ns = time_ns([&] {
+        size_t i = 0;
+        for (D &d : ds)
+          for (size_t j = 0; j < k; ++j, ++i)
+            d.insert(d.begin() + long(picks[i]), int(j));
+      });
+    } else {
+      ns = time_ns([&] {
+        size_t i = 0;
+        for (D &d : ds)
+          for (size_t j = 0; j < k; ++j, ++i)
+            d.erase(d.begin() + long(picks[i]));
+      });
+    }
+    break;
+  }
+  case copy_op: {
+    ds.resize(1);
+    fill(ds[0], n);
+    std::vector<D> copies;
+    copies.reserve(rounds);
+    ops = rounds * n;
+    ns = time_ns([&] {
+      for (size_t r = 0; r < rounds; ++r)
+        copies.emplace_back(ds[0]);
+    });
+    sum += copies.back()[n / 2];
+    break;
+  }
+  default:
+    break;
+  }
+  sink = sum;
+  return ns / ops;
+}
+
+template <class D>
+result measure(const char *container, operation op, size_t n, size_t reps,
+               std::mt19937_64 &rng) {
+  size_t ops = 0;
+  run_once<D>(op, n, rng, ops); // Warmup
+  std::vector<double> samples;
+  for (size_t r = 0; r < reps; ++r)
+    samples.push_back(run_once<D>(op, n, rng, ops));
+  return {container, op, n, ops, summarize(samples)};
+}
+
+void write_json(std::FILE *out, const std::vector<result> &results,
+                size_t reps) {
+  std::fprintf(out, "{\n  \"benchmark\": \"deque_suite\",\n");
+  std::fprintf(out, "  \"unit\": \"ns_per_op\",\n");
+  std::fprintf(out, "  \"repetitions\": %zu,\n  \"results\": [", reps);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const result &r = results[i];
+    const summary &s = r.ns_per_op;
+    std::fprintf(out,
+                 "%s\n    {\"container\": \"%s\", \"operation\": \"%s\", "
+                 "\"size\": %zu, \"ops\": %zu, \"min\": %.3f, \"p50\": %.3f, "
+                 "\"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f, "
+                 "\"mean\": %.3f}",
+                 i ? "," : "", r.container, operation_names[r.op], r.size,
+                 r.ops, s.min, s.p50, s.p90, s.p99, s.max, s.mean);
+  }
+  std::fprintf(out, "\n  ]\n}\n");
+}
+
+size_t parse_size(const char *s) { return (size_t)std::strtod(s, nullptr); }
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t min_n = 1000, max_n = 10000000, reps = 11;
+  const char *json = nullptr;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!std::strcmp(argv[i], "--min"))
+      min_n = parse_size(argv[i + 1]);
+    else if (!std::strcmp(argv[i], "--max"))
+      max_n = parse_size(argv[i + 1]);
+    else if (!std::strcmp(argv[i], "--reps"))
+      reps = parse_size(argv[i + 1]);
+    else if (!std::strcmp(argv[i], "--json"))
+      json = argv[i + 1];
+    else {
+      std::fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (min_n == 0)
+    min_n = 1;
+  if (reps == 0)
+    reps = 1;
+  bool table = !json || std::strcmp(json, "-") != 0;
+
+  std::mt19937_64 rng(20250101);
+  std::vector<result> results;
+  if (table)
+    std::printf("%-14s %10s %14s %14s %8s\n", "operation", "size",
+                "sjtu p50 ns", "std p50 ns", "ratio");
+  for (size_t n = min_n; n <= max_n; n *= 10) {
+    for (int o = 0; o < operation_count; ++o) {
+      operation op = operation(o);
+      result mine = measure<sjtu::deque<int>>("sjtu::deque", op, n, reps, rng);
+      result theirs = measure<std::deque<int>>("std::deque", op, n, reps, rng);
+      results.push_back(mine);
+      results.push_back(theirs);
+      if (table) {
+        std::printf("%-14s %10zu %14.2f %14.2f %8.2f\n", operation_names[op], n,
+                    mine.ns_per_op.p50, theirs.ns_per_op.p50,
+                    mine.ns_per_op.p50 / theirs.ns_per_op.p50);
+        std::fflush(stdout);
+      }
+    }
+    if (n > max_n / 10)
+      break;
+  }
+
+  if (json) {
+    std::FILE *out = table ? std::fopen(json, "w") : stdout;
+    if (!out) {
+      std::fprintf(stderr, "cannot open %s\n", json);
+      return 1;
+    }
+    write_json(out, results, reps);
+    if (out != stdout)
+      std::fclose(out);
+  }
+  return 0;
+}
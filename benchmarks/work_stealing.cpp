@@ -0,0 +1,114 @@
+// Throughput of work_stealing_deque against a mutex-guarded sjtu::deque used
+// as a task queue: the owner pushes and pops at the back while thieves steal
+// from the front, from no thieves up to every hardware thread.
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -pthread -I. benchmarks/work_stealing.cpp -o ws
+#include "bench_common.hpp"
+#include "deque.hpp"
+#include "work_stealing_deque.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using bench::time_us;
+
+class locked_queue {
+private:
+  std::mutex lock;
+  sjtu::deque<long> tasks;
+
+public:
+  void push(long x) {
+    std::lock_guard<std::mutex> guard(lock);
+    tasks.push_back(x);
+  }
+  bool pop(long &x) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (tasks.empty())
+      return false;
+    x = tasks.back();
+    tasks.pop_back();
+    return true;
+  }
+  bool steal(long &x) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (tasks.empty())
+      return false;
+    x = tasks.front();
+    tasks.pop_front();
+    return true;
+  }
+};
+
+// The owner pushes n tasks in batches of 64 and pops half of each batch;
+// thieves steal until the owner is done and the queue is empty. Returns
+// millions of tasks taken per second.
+template <class Queue> double run(size_t n, size_t thieves) {
+  Queue q;
+  std::atomic<bool> done(false);
+  std::atomic<long> checksum(0);
+  std::vector<std::thread> threads;
+  double us = time_us([&] {
+    for (size_t i = 0; i < thieves; ++i)
+      threads.emplace_back([&] {
+        long x, sum = 0;
+        for (;;) {
+          bool finished = done.load(std::memory_order_acquire);
+          if (q.steal(x))
+            sum += x;
+          else if (finished)
+            break;
+        }
+        checksum.fetch_add(sum);
+      });
+
+    long x, sum = 0;
+    for (size_t i = 0; i < n; i += 64) {
+      for (size_t k = 0; k < 64; ++k)
+        q.push(long(i + k));
+      for (size_t k = 0; k < 32 && q.pop(x); ++k)
+        sum += x;
+    }
+    while (q.pop(x))
+      sum += x;
+    done.store(true, std::memory_order_release);
+    for (auto &t : threads)
+      t.join();
+    checksum.fetch_add(sum);
+  });
+
+  long expect = long(n) * long(n - 1) / 2;
+  if (checksum.load() != expect)
+    std::printf("checksum mismatch\n");
+  return n / us;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  size_t max_threads = std::thread::hardware_concurrency();
+  if (argc > 2)
+    max_threads = std::strtoul(argv[2], nullptr, 10);
+  if (max_threads == 0)
+    max_threads = 1;
+  n = n / 64 * 64;
+
+  std::printf("n = %zu tasks, millions of tasks per second\n", n);
+  std::printf("%8s %16s %16s\n", "thieves", "mutex + deque",
+              "work_stealing");
+  for (size_t thieves = 0;; thieves = thieves == 0 ? 1 : thieves * 2) {
+    if (thieves > max_threads - 1)
+      thieves = max_threads - 1;
+    std::printf("%8zu %16.2f %16.2f\n", thieves, run<locked_queue>(n, thieves),
+                run<sjtu::work_stealing_deque<long>>(n, thieves));
+    if (thieves == max_threads - 1)
+      break;
+  }
+  return 0;
+}
@@ -0,0 +1,254 @@
+#ifndef SJTU_BLOCK_INDEX_HPP
+#define SJTU_BLOCK_INDEX_HPP
+
+#include <cstddef>
+
+namespace sjtu {
+
+/**
+ * Order-statistic index over the blocks of an unrolled list.
+ * Keeps a table of block iterators in list order together with a Fenwick
+ * tree of block sizes, so the block holding a global position is found in
+ * O(log B) and a block's starting position is a prefix sum.
+ *
+ * BlockIter must dereference to a type with a `size_t ordinal` member and a
+ * `data.size()` accessor. Element count changes inside a block are applied
+ * with add(); structural changes (blocks created, removed, split or merged)
+ * only invalidate the index, which is rebuilt in O(B) on the next lookup.
+ *
+ * The block found by the last seek() and its starting position are cached.
+ * A lookup in that block or one of its neighbours is answered from the
+ * cache in O(1), so sequential and nearby indexed access skips the tree.
+ * add() keeps the cached start exact, and invalidation drops it.
+ *
+ * Only seek() moves the cache. The const find() reads it but never writes
+ * it, so several threads may run const lookups at once. An invalidated
+ * index is still rebuilt by the first lookup, const or not, so those
+ * threads must not be the first to read after a structural change.
+ */
+template <class BlockIter> class block_index {
+private:
+  BlockIter *table; // Blocks in list order
+  size_t *tree;     // 1-based Fenwick tree of block sizes
+  size_t count;     // Number of indexed blocks
+  size_t cap;       // Allocated length of table and tree
+  bool valid;       // Whether table and tree match the block list
+  bool near_valid = false; // Whether near and near_base are set
+  size_t near = 0;         // Ordinal of the last block sought
+  size_t near_base = 0;    // Global position of its first element
+  size_t near_size = 0;    // Number of elements in it
+#ifdef SJTU_DEQUE_STATS
+  mutable size_t probes = 0; // Entries read by find() and prefix()
+#endif
+
+  static size_t lowbit(size_t i) { return i & (~i + 1); }
+
+  /**
+   * Look pos up in the cached block and, when pos lies within one block
+   * length of it, in the neighbour on that side
+   * @param i Set to the ordinal of the block holding pos
+   * @param base Set to that block's starting position
+   * @param n Set to that block's size
+   * @return Whether one of them held pos
+   */
+  bool find_near(size_t pos, size_t &i, size_t &base, size_t &n) const {
+    i = near;
+    base = near_base;
+    n = near_size;
+    probed();
+    if (pos - base < n)
+      return true;
+    // Far positions skip the neighbours rather than read their nodes
+    if (pos >= base + n && pos - base < 2 * n && i + 1 < count) {
+      base += n;
+      n = table[++i]->data.size();
+      probed();
+    } else if (pos < base && base - pos <= n && i > 0) {
+      n = table[--i]->data.size();
+      base -= n;
+      probed();
+    }
+    return pos >= base && pos < base + n;
+  }
+
+  /**
+   * Walk the Fenwick tree down to the block holding pos in O(log B)
+   * @param pos Global position, replaced by the offset inside the block
+   * @return Ordinal of that block
+   */
+  size_t descend(size_t &pos) const {
+    size_t i = 0;
+    size_t step = 1;
+    while (step * 2 <= count)
+      step *= 2;
+    for (; step > 0; step /= 2) {
+      probed();
+      if (i + step <= count && tree[i + step] <= pos) {
+        i += step;
+        pos -= tree[i];
+      }
+    }
+    return i;
+  }
+
+  void probed() const {
+#ifdef SJTU_DEQUE_STATS
+    ++probes;
+#endif
+  }
+
+public:
+  block_index()
+      : table(nullptr), tree(nullptr), count(0), cap(0), valid(false) {}
+
+  // The index refers to another container's blocks, so copies start empty
+  block_index(const block_index &)
+      : table(nullptr), tree(nullptr), count(0), cap(0), valid(false) {}
+
+  block_index &operator=(const block_index &) {
+    valid = near_valid = false;
+    return *this;
+  }
+
+  ~block_index() {
+    delete[] table;
+    delete[] tree;
+  }
+
+  bool is_valid() const { return valid; }
+
+  // Tree entries read by lookups so far; always 0 unless SJTU_DEQUE_STATS
+  // is defined
+  size_t probe_count() const {
+#ifdef SJTU_DEQUE_STATS
+    return probes;
+#else
+    return 0;
+#endif
+  }
+
+  void invalidate() { valid = near_valid = false; }
+
+  // Bytes allocated for the table and tree
+  size_t memory_bytes() const {
+    return cap == 0 ? 0 : cap * sizeof(BlockIter) + (cap + 1) * sizeof(size_t);
+  }
+
+  // Free the table and tree; the next rebuild allocates them to fit
+  void release() {
+    delete[] table;
+    delete[] tree;
+    table = nullptr;
+    tree = nullptr;
+    count = cap = 0;
+    valid = near_valid = false;
+  }
+
+  /**
+   * Rebuild the index from a range of blocks in O(B)
+   * @param first Iterator to the first block
+   * @param last Iterator past the last block
+   */
+  void rebuild(BlockIter first, BlockIter last) {
+    size_t n = 0;
+    for (BlockIter it = first; it != last; ++it)
+      ++n;
+    if (n > cap) {
+      delete[] table;
+      delete[] tree;
+      cap = n * 2;
+      table = new BlockIter[cap];
+      tree = new size_t[cap + 1];
+    }
+    count = n;
+    tree[0] = 0;
+    size_t i = 0;
+    for (BlockIter it = first; it != last; ++it) {
+      it->ordinal = i;
+      table[i] = it;
+      tree[++i] = it->data.size();
+    }
+    for (i = 1; i <= count; ++i) {
+      size_t parent = i + lowbit(i);
+      if (parent <= count)
+        tree[parent] += tree[i];
+    }
+    valid = true;
+    near_valid = false;
+  }
+
+  /**
+   * Record a change in the element count of one block
+   * @param ordinal Ordinal of the block
+   * @param delta Signed change in its size
+   */
+  void add(size_t ordinal, long delta) {
+    if (!valid)
+      return;
+    if (near_valid && ordinal < near)
+      near_base += delta;
+    else if (near_valid && ordinal == near)
+      near_size += delta;
+    for (size_t i = ordinal + 1; i <= count; i += lowbit(i))
+      tree[i] += delta;
+  }
+
+  /**
+   * Number of elements stored in blocks before the given one
+   * @param ordinal Ordinal of the block
+   */
+  size_t prefix(size_t ordinal) const {
+    if (near_valid && ordinal == near) {
+      probed();
+      return near_base;
+    }
+    size_t sum = 0;
+    for (size_t i = ordinal; i > 0; i -= lowbit(i)) {
+      probed();
+      sum += tree[i];
+    }
+    return sum;
+  }
+
+  /**
+   * Find the block containing a global position, using the cache but
+   * leaving it unchanged
+   * @param pos Global position, replaced by the offset inside the block
+   * @return Iterator to the block holding that position
+   */
+  BlockIter find(size_t &pos) const {
+    size_t i, base, n;
+    if (near_valid && find_near(pos, i, base, n)) {
+      pos -= base;
+      return table[i];
+    }
+    return table[descend(pos)];
+  }
+
+  /**
+   * Find the block containing a global position and cache it, so the
+   * next lookup near it is O(1)
+   * @param pos Global position, replaced by the offset inside the block
+   * @return Iterator to the block holding that position
+   */
+  BlockIter seek(size_t &pos) {
+    size_t i, base, n;
+    if (!near_valid || !find_near(pos, i, base, n)) {
+      base = pos;
+      i = descend(pos);
+      base -= pos;
+      n = table[i]->data.size();
+    } else {
+      pos -= base;
+    }
+    near_valid = true;
+    near = i;
+    near_base = base;
+    near_size = n;
+    return table[i];
+  }
+};
+
+} // namespace sjtu
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SJTU_BLOCK_POLICY_HPP
+#define SJTU_BLOCK_POLICY_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace sjtu {
+
+/**
+ * Block sizing policies for deque, selected through its BlockPolicy template
+ * parameter. A policy provides, for element type T and a deque holding n
+ * elements:
+ *
+ *   template <class T> static size_t max_size(size_t n);
+ *   template <class T> static size_t min_size(size_t n);
+ *
+ * A block is split once it holds more than max_size elements, and a block
+ * smaller than min_size is merged into a neighbour when the result fits.
+ * Policies that ignore n compile down to constants, so the end operations
+ * do no sizing arithmetic at run time.
+ */
+
+// Adaptive rule: blocks of about √n elements, giving O(√n) blocks
+struct sqrt_block_policy {
+  template <class T> static size_t max_size(size_t n) {
+    return std::max(size_t(200), (size_t)std::sqrt(n));
+  }
+
+  template <class T> static size_t min_size(size_t n) {
+    return std::max(size_t(100), (size_t)std::sqrt(n) / 3);
+  }
+};
+
+// Blocks of a fixed number of bytes, at least one element each
+template <size_t Bytes = 4096> struct fixed_bytes_block_policy {
+  template <class T> static constexpr size_t max_size(size_t) {
+    return Bytes / sizeof(T) > 1 ? Bytes / sizeof(T) : 1;
+  }
+
+  template <class T> static constexpr size_t min_size(size_t n) {
+    return max_size<T>(n) / 3;
+  }
+};
+
+// One page per block
+typedef fixed_bytes_block_policy<4096> page_block_policy;
+
+/**
+ * Blocks spanning a fixed number of cache lines. Small elements are packed
+ * LineSize / sizeof(T) to a line; elements larger than a line still get
+ * Lines of them per block, so the per-block overhead stays amortized over
+ * the same element count.
+ */
+template <size_t Lines = 64, size_t LineSize = 64>
+struct cache_line_block_policy {
+  template <class T> static constexpr size_t max_size(size_t) {
+    return Lines * (LineSize / sizeof(T) > 1 ? LineSize / sizeof(T) : 1);
+  }
+
+  template <class T> static constexpr size_t min_size(size_t n) {
+    return max_size<T>(n) / 3;
+  }
+};
+
+} // namespace sjtu
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef SJTU_CONCURRENT_DEQUE_HPP
+#define SJTU_CONCURRENT_DEQUE_HPP
+
+#include "block_policy.hpp"
+#include "ring_buffer.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace sjtu {
+
+/**
+ * Thread-safe deque for MPMC queues, built from the same ring_buffer blocks
+ * as deque, with one lock per end.
+ *
+ * The front lock guards the head block and the back lock the tail block.
+ * When they are different blocks, an operation takes only the lock of its
+ * end, so producers at one end and consumers at the other do not serialize.
+ * Both locks are needed, always front then back, only when the deque is down
+ * to a single block, or an end block is about to be emptied and unlinked.
+ * The second case happens once per block of elements.
+ *
+ * Invariant: when head != tail, both end blocks hold at least one element.
+ * The head can only move onto the tail, and the tail onto the head, with
+ * both locks held. An end that sees two distinct blocks while holding its
+ * own lock therefore keeps them distinct until it unlocks.
+ *
+ * Blocks hold BlockPolicy::max_size<T>(0) elements; they are never resized
+ * after creation. Alloc must be safe to use from both ends at once.
+ */
+template <class T, class Alloc = std::allocator<T>,
+          class BlockPolicy = page_block_policy>
+class concurrent_deque {
+private:
+  typedef ring_buffer<T, Alloc> buffer;
+
+  struct block {
+    buffer data;
+    block *prev;
+    block *next;
+
+    block(size_t capacity, const Alloc &a)
+        : data(capacity, a), prev(nullptr), next(nullptr) {}
+  };
+
+  typedef typename std::allocator_traits<Alloc>::template rebind_alloc<block>
+      block_allocator;
+  typedef std::allocator_traits<block_allocator> block_traits;
+
+  // One end of the deque, on its own cache line so the two ends do not
+  // invalidate each other
+  struct alignas(64) end_state {
+    std::mutex lock;
+    std::atomic<block *> at;    // End block, written under lock
+    std::atomic<long> net;      // Elements added minus removed at this end
+  };
+
+  Alloc alloc;
+  size_t block_capacity;
+  end_state front_end;
+  end_state back_end;
+
+  block *new_block() {
+    block_allocator a(alloc);
+    block *b = block_traits::allocate(a, 1);
+    try {
+      block_traits::construct(a, b, block_capacity, alloc);
+    } catch (...) {
+      block_traits::deallocate(a, b, 1);
+      throw;
+    }
+    return b;
+  }
+
+  void delete_block(block *b) {
+    block_allocator a(alloc);
+    block_traits::destroy(a, b);
+    block_traits::deallocate(a, b, 1);
+  }
+
+public:
+  typedef T value_type;
+  typedef Alloc allocator_type;
+
+  explicit concurrent_deque(const Alloc &a = Alloc())
+      : alloc(a), block_capacity(BlockPolicy::template max_size<T>(0)) {
+    block *b = new_block();
+    front_end.at.store(b);
+    back_end.at.store(b);
+    front_end.net.store(0);
+    back_end.net.store(0);
+  }
+
+  concurrent_deque(const concurrent_deque &) = delete;
+  concurrent_deque &operator=(const concurrent_deque &) = delete;
+
+  ~concurrent_deque() {
+    block *b = front_end.at.load();
+    while (b) {
+      block *next = b->next;
+      delete_block(b);
+      b = next;
+    }
+  }
+
+  /**
+   * Construct an element at the back
+   * @throw Whatever allocation or T's constructor throws; the deque is
+   * unchanged then
+   */
+  template <class... Args> void emplace_back(Args &&...args) {
+    std::unique_lock<std::mutex> back_guard(back_end.lock);
+    std::unique_lock<std::mutex> front_guard;
+    block *t = back_end.at.load(std::memory_order_relaxed);
+    if (t == front_end.at.load(std::memory_order_acquire)) {
+      back_guard.unlock();
+      front_guard = std::unique_lock<std::mutex>(front_end.lock);
+      back_guard.lock();
+      t = back_end.at.load(std::memory_order_relaxed);
+    }
+    if (t->data.full()) {
+      // Fill the new block before linking it, so a throw leaves no empty
+      // end block behind
+      block *b = new_block();
+      try {
+        b->data.emplace_back(std::forward<Args>(args)...);
+      } catch (...) {
+        delete_block(b);
+        throw;
+      }
+      b->prev = t;
+      t->next = b;
+      back_end.at.store(b, std::memory_order_release);
+    } else {
+      t->data.emplace_back(std::forward<Args>(args)...);
+    }
+    back_end.net.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Construct an element at the front
+   * @throw Whatever allocation or T's constructor throws; the deque is
+   * unchanged then
+   */
+  template <class... Args> void emplace_front(Args &&...args) {
+    std::unique_lock<std::mutex> front_guard(front_end.lock);
+    std::unique_lock<std::mutex> back_guard(back_end.lock, std::defer_lock);
+    block *h = front_end.at.load(std::memory_order_relaxed);
+    if (h == back_end.at.load(std::memory_order_acquire))
+      back_guard.lock();
+    if (h->data.full()) {
+      block *b = new_block();
+      try {
+        b->data.emplace_front(std::forward<Args>(args)...);
+      } catch (...) {
+        delete_block(b);
+        throw;
+      }
+      b->next = h;
+      h->prev = b;
+      front_end.at.store(b, std::memory_order_release);
+    } else {
+      h->data.emplace_front(std::forward<Args>(args)...);
+    }
+    front_end.net.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void push_back(const T &value) { emplace_back(value); }
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+  void push_front(const T &value) { emplace_front(value); }
+  void push_front(T &&value) { emplace_front(std::move(value)); }
+
+  /**
+   * Move the first element into out and remove it
+   * @return false if the deque was empty
+   */
+  bool try_pop_front(T &out) {
+    std::unique_lock<std::mutex> front_guard(front_end.lock);
+    std::unique_lock<std::mutex> back_guard(back_end.lock, std::defer_lock);
+    block *h = front_end.at.load(std::memory_order_relaxed);
+    // Both locks if the tail shares this block or is about to become the
+    // head
+    if (h == back_end.at.load(std::memory_order_acquire) ||
+        h->data.size() == 1)
+      back_guard.lock();
+    if (h->data.empty())
+      return false;
+    out = std::move(h->data.front());
+    h->data.pop_front();
+    if (h->data.empty() && h != back_end.at.load(std::memory_order_relaxed)) {
+      block *next = h->next;
+      next->prev = nullptr;
+      front_end.at.store(next, std::memory_order_release);
+      delete_block(h);
+    }
+    front_end.net.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * Move the last element into out and remove it
+   * @return false if the deque was empty
+   */
+  bool try_pop_back(T &out) {
+    std::unique_lock<std::mutex> back_guard(back_end.lock);
+    std::unique_lock<std::mutex> front_guard;
+    block *t = back_end.at.load(std::memory_order_relaxed);
+    if (t == front_end.at.load(std::memory_order_acquire) ||
+        t->data.size() == 1) {
+      // Relock in the front-then-back order
+      back_guard.unlock();
+      front_guard = std::unique_lock<std::mutex>(front_end.lock);
+      back_guard.lock();
+      t = back_end.at.load(std::memory_order_relaxed);
+    }
+    if (t->data.empty())
+      return false;
+    out = std::move(t->data.back());
+    t->data.pop_back();
+    if (t->data.empty() && t != front_end.at.load(std::memory_order_relaxed)) {
+      block *prev = t->prev;
+      prev->next = nullptr;
+      back_end.at.store(prev, std::memory_order_release);
+      delete_block(t);
+    }
+    back_end.net.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Number of elements; exact only while no other thread is operating
+  size_t size() const {
+    long n = front_end.net.load(std::memory_order_relaxed) +
+             back_end.net.load(std::memory_order_relaxed);
+    return n > 0 ? size_t(n) : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  allocator_type get_allocator() const { return alloc; }
+};
+
+} // namespace sjtu
+
+#endif
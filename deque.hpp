@@ -1,65 +1,247 @@
 #ifndef SJTU_DEQUE_HPP
 #define SJTU_DEQUE_HPP
 
+#include "block_index.hpp"
+#include "block_policy.hpp"
+#include "deque_stats.hpp"
 #include "double_list.hpp"
 #include "exceptions.hpp"
-#include <cmath>
+#include "ring_buffer.hpp"
 #include <cstddef>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 namespace sjtu {
-template <class T> class deque {
+template <class T, class Alloc = std::allocator<T>,
+          class BlockPolicy = sqrt_block_policy>
+class deque {
 
 private:
-  // Internal block structure containing a double_list of elements
+  typedef ring_buffer<T, Alloc> buffer;
+
+  // Internal block structure storing its elements contiguously. Blocks are
+  // move-only so creating and relinking them never copies elements.
   struct block {
-    double_list<T> data;
+    buffer data;
+    size_t ordinal = 0; // Position in the block index, set on rebuild
+
+    block() {}
+    block(size_t capacity, const Alloc &a) : data(capacity, a) {}
+    explicit block(buffer &&storage) : data(std::move(storage)) {}
+    block(block &&other) = default;
+    block &operator=(block &&other) = default;
+    block(const block &other) = delete;
+    block &operator=(const block &other) = delete;
   };
 
-  double_list<block> blocks; // List of blocks
-  size_t total_size;         // Total number of elements in deque
+  // Block list nodes are allocated through Alloc rebound to block
+  typedef typename std::allocator_traits<Alloc>::template rebind_alloc<block>
+      block_allocator;
+  typedef double_list<block, block_allocator> block_list;
+  typedef typename block_list::iterator block_iterator;
+  typedef typename block_list::const_iterator const_block_iterator;
+
+  Alloc alloc;       // Allocator for element storage
+  block_list blocks; // List of blocks
+  size_t total_size; // Total number of elements in deque
+
+  // Prefix index over block sizes, rebuilt lazily after structural changes
+  mutable block_index<block_iterator> index;
+
+  // Spare block storage, kept per end in a stack of buffers
+  typedef typename std::allocator_traits<Alloc>::template rebind_alloc<buffer>
+      spare_allocator;
+  typedef ring_buffer<buffer, spare_allocator> spare_stack;
+
+  // Storage of blocks emptied at each end, plus any reserved ahead of time.
+  // An end block is opened when its neighbour is full and unlinked as soon
+  // as it empties, so a push/pop oscillation across that boundary would
+  // otherwise allocate and free a block per cycle. New end blocks take a
+  // spare from their own end first and then from the other one, so a FIFO
+  // queue recycles the blocks it pops off the front at the back.
+  spare_stack front_spares{spare_allocator(alloc)};
+  spare_stack back_spares{spare_allocator(alloc)};
+  size_t spare_limit = 1; // Emptied blocks kept per end
+
+#ifdef SJTU_DEQUE_STATS
+  mutable deque_stats counters; // Only the counter fields are used
+#endif
+
+  // Add n to one counter; compiled out unless SJTU_DEQUE_STATS is defined
+  void count(size_t deque_stats::*counter, size_t n = 1) const {
+#ifdef SJTU_DEQUE_STATS
+    counters.*counter += n;
+#else
+    (void)counter;
+    (void)n;
+#endif
+  }
+
+  // Counts one lookup, and the index entries it probes while in scope,
+  // into a pair of counters; empty unless SJTU_DEQUE_STATS is defined
+  struct lookup_probe {
+#ifdef SJTU_DEQUE_STATS
+    const deque &dq;
+    size_t deque_stats::*visited;
+    size_t start;
+
+    lookup_probe(const deque &d, size_t deque_stats::*calls,
+                 size_t deque_stats::*v)
+        : dq(d), visited(v), start(d.index.probe_count()) {
+      ++(d.counters.*calls);
+    }
+    ~lookup_probe() {
+      dq.counters.*visited += dq.index.probe_count() - start;
+    }
+#else
+    lookup_probe(const deque &, size_t deque_stats::*, size_t deque_stats::*) {
+    }
+#endif
+  };
 
-  // Calculate minimum block size based on total elements
+  // Minimum block size for the current number of elements
   size_t min_block_size() const {
-    return std::max(size_t(100), (size_t)std::sqrt(total_size) / 3);
+    return BlockPolicy::template min_size<T>(total_size);
   }
 
-  // Calculate maximum block size based on total elements
-  size_t max_block_size() const {
-    return std::max(size_t(200), (size_t)std::sqrt(total_size));
+  // Maximum block size for the current number of elements
+  size_t max_block_size() const { return max_block_size_for(total_size); }
+
+  // Maximum block size once the deque holds n elements
+  static size_t max_block_size_for(size_t n) {
+    return BlockPolicy::template max_size<T>(n);
   }
 
+  // Capacity of a freshly created block: one slot of headroom above the
+  // split threshold so a full block never reallocates before splitting
+  size_t new_block_capacity() const { return max_block_size() + 1; }
+
   /**
-   * Split a block if it exceeds maximum size
-   * @param it Iterator pointing to the block to split
+   * Pop a spare of at least cap slots, freeing smaller ones on the way
+   * @return Whether out received a spare
    */
-  void split_block(typename double_list<block>::iterator it) {
-    if (it->data.size() <= max_block_size())
+  static bool take_spare(spare_stack &spares, size_t cap, buffer &out) {
+    while (!spares.empty()) {
+      bool fits = spares.back().capacity() >= cap;
+      if (fits)
+        out = std::move(spares.back());
+      spares.pop_back();
+      if (fits)
+        return true;
+    }
+    return false;
+  }
+
+  // Storage for a new end block: a spare from that end, then one from the
+  // other end, otherwise a fresh buffer
+  buffer take_storage(spare_stack &near, spare_stack &far) {
+    size_t cap = new_block_capacity();
+    buffer storage(alloc);
+    if (take_spare(near, cap, storage) || take_spare(far, cap, storage))
+      return storage;
+    return buffer(cap, alloc);
+  }
+
+  // Keep the storage of an emptied end block as a spare of that end while
+  // the end holds fewer than spare_limit
+  void retire_storage(block &b, spare_stack &spares) {
+    if (b.data.capacity() > 0 && spares.size() < spare_limit)
+      spares.push_back(std::move(b.data));
+  }
+
+  // Drop the storage kept at both ends
+  void release_spares() {
+    front_spares.clear();
+    back_spares.clear();
+  }
+
+  /**
+   * Add spares to one end until n more elements can be pushed there
+   * without allocating
+   * @param n Number of elements to make room for
+   * @param end_block Block at that end, or nullptr if there is none
+   * @param spares Spares of that end
+   */
+  void reserve_end(size_t n, const block *end_block, spare_stack &spares) {
+    // Pushes fill the end block up to the current maximum, and every block
+    // opened later holds at least that many
+    size_t per_block = max_block_size();
+    if (end_block != nullptr) {
+      size_t limit = std::min(per_block, end_block->data.capacity());
+      size_t room =
+          end_block->data.size() < limit ? limit - end_block->data.size() : 0;
+      n = n > room ? n - room : 0;
+    }
+    size_t needed = (n + per_block - 1) / per_block;
+
+    // Size the storage for the final element count, so that it is still
+    // accepted once the adaptive block size has grown
+    size_t cap = max_block_size_for(total_size + n) + 1;
+    size_t usable = 0;
+    for (size_t i = 0; i < spares.size(); ++i)
+      if (spares[i].capacity() >= cap)
+        ++usable;
+    blocks.reserve_nodes(needed);
+    if (usable >= needed)
       return;
+    spares.reserve(spares.size() + needed - usable);
+    for (; usable < needed; ++usable)
+      spares.emplace_back(cap, alloc);
+  }
 
-    // Create new block with half the elements
-    double_list<T> new_block_data;
-    auto split_it = it->data.begin();
-    for (int i = 0; i < it->data.size() / 2; i++) {
-      split_it++;
+  // Rebuild the block index if blocks were created, removed, split or
+  // merged since the last lookup
+  void refresh_index() const {
+    if (!index.is_valid()) {
+      auto &list = const_cast<block_list &>(blocks);
+      index.rebuild(list.begin(), list.end());
+      count(&deque_stats::index_rebuilds);
+      count(&deque_stats::index_rebuild_blocks, list.size());
     }
-    new_block_data.splice(new_block_data.begin(), it->data, split_it,
-                          it->data.end());
+  }
 
-    block new_block;
-    new_block.data = new_block_data;
+  /**
+   * Find the block holding a global position and cache it in the index
+   * @param pos Global position, replaced by the offset inside the block
+   * @return Iterator to the block holding that position
+   */
+  block_iterator locate(size_t &pos) {
+    refresh_index();
+    return index.seek(pos);
+  }
 
-    // Insert new block after current block
-    auto next_it = ++it;
-    blocks.insert(next_it, new_block);
+  // Const version of locate(); reads the index cache but leaves it as it is
+  block_iterator locate(size_t &pos) const {
+    refresh_index();
+    return index.find(pos);
+  }
+
+  /**
+   * Split a block if it exceeds maximum size
+   * @param it Iterator pointing to the block to split
+   */
+  void split_block(block_iterator it) {
+    if (it->data.size() <= max_block_size())
+      return;
+
+    // Create an empty block after the current one in place, then move the
+    // upper half of the elements into it
+    auto next_it = it;
+    ++next_it;
+    auto new_it = blocks.emplace(next_it, new_block_capacity(), alloc);
+    new_it->data.splice(it->data, it->data.size() / 2);
+    index.invalidate();
+    count(&deque_stats::splits);
   }
 
   /**
    * Merge adjacent blocks if their combined size is within limits
    * @param it Iterator pointing to the first block to merge
    */
-  void merge_blocks(typename double_list<block>::iterator it) {
+  void merge_blocks(block_iterator it) {
     if (it == blocks.end())
       return;
     auto next_it = it;
@@ -70,9 +252,37 @@ private:
       return;
 
     // Move all elements from next block to current block
-    it->data.splice(it->data.end(), next_it->data, next_it->data.begin(),
-                    next_it->data.end());
+    it->data.splice(next_it->data);
+    blocks.erase(next_it);
+    index.invalidate();
+    count(&deque_stats::merges);
+  }
+
+  /**
+   * Close the seam between a block and the next one after a bulk insert:
+   * merge them if they fit in one block, otherwise even them out when
+   * either is below the minimum block size
+   * @param it Iterator to the block in front of the seam
+   */
+  void join_seam(block_iterator it) {
+    if (it == blocks.end())
+      return;
+    auto next_it = it;
+    ++next_it;
+    if (next_it == blocks.end())
+      return;
+    if (it->data.size() + next_it->data.size() <= max_block_size()) {
+      merge_blocks(it);
+      return;
+    }
+    size_t low = min_block_size();
+    if (it->data.size() >= low && next_it->data.size() >= low)
+      return;
+    it->data.splice(next_it->data);
     blocks.erase(next_it);
+    index.invalidate();
+    count(&deque_stats::merges);
+    split_block(it);
   }
 
 public:
@@ -83,35 +293,28 @@ public:
     friend class deque;
 
   private:
-    typename double_list<block>::iterator block_it; // Current block
-    typename double_list<T>::iterator iter;         // Current element in block
-    deque *dq;                                      // Pointer to deque
+    block_iterator block_it; // Current block
+    size_t idx;              // Index within block
+    deque *dq;               // Pointer to deque
 
   public:
-    iterator() {}
-    iterator(typename double_list<T>::iterator iter,
-             typename double_list<block>::iterator b_it, deque *dq)
-        : iter(iter), block_it(b_it), dq(dq) {}
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef int difference_type;
+    typedef T *pointer;
+    typedef T &reference;
+
+    iterator() : idx(0), dq(nullptr) {}
+    iterator(size_t idx, block_iterator b_it, deque *dq)
+        : block_it(b_it), idx(idx), dq(dq) {}
 
     // Prefix increment
     iterator &operator++() {
-      if (iter != block_it->data.end()) {
-        ++iter;
-        if (iter == block_it->data.end()) {
-          ++block_it;
-          if (block_it != dq->blocks.end()) {
-            iter = block_it->data.begin();
-          } else {
-            iter = typename double_list<T>::iterator();
-          }
-        }
-      } else {
+      if (block_it == dq->blocks.end())
+        throw invalid_iterator();
+      if (++idx == block_it->data.size()) {
         ++block_it;
-        if (block_it != dq->blocks.end()) {
-          iter = block_it->data.begin();
-        } else {
-          iter = typename double_list<T>::iterator();
-        }
+        idx = 0;
       }
       return *this;
     }
@@ -125,19 +328,13 @@ public:
 
     // Prefix decrement
     iterator &operator--() {
-      if (block_it == dq->blocks.end()) {
-        --block_it;
-        iter = block_it->data.end();
-      }
-      if (iter == block_it->data.begin()) {
-        if (block_it != dq->blocks.begin()) {
-          --block_it;
-          iter = block_it->data.end();
-        } else {
+      if (idx == 0) {
+        if (block_it == dq->blocks.begin())
           throw invalid_iterator();
-        }
+        --block_it;
+        idx = block_it->data.size();
       }
-      --iter;
+      --idx;
       return *this;
     }
 
@@ -149,10 +346,14 @@ public:
     }
 
     // Dereference operator
-    T &operator*() const { return *iter; }
+    T &operator*() const {
+      if (block_it == dq->blocks.end())
+        throw invalid_iterator();
+      return block_it->data[idx];
+    }
 
     // Arrow operator
-    T *operator->() const noexcept { return &(*iter); }
+    T *operator->() const noexcept { return &block_it->data[idx]; }
 
     /**
      * Addition operator for iterator arithmetic
@@ -164,63 +365,13 @@ public:
         return *this;
       if (n < 0)
         return *this - (-n);
+      lookup_probe probe(*dq, &deque_stats::jump_calls,
+                         &deque_stats::jump_blocks_visited);
 
-      iterator temp = *this;
-      int remain = n;
-
-      // Calculate elements remaining in current block
-      int elements_to_end = 0;
-      auto it_copy = temp.iter;
-      auto block_end = temp.block_it->data.end();
-      while (it_copy != block_end) {
-        ++it_copy;
-        ++elements_to_end;
-      }
-
-      // If can complete within current block
-      if (remain < elements_to_end) {
-        for (int i = 0; i < remain; i++)
-          ++temp;
-        return temp;
-      }
-
-      // Need to cross blocks
-      remain -= elements_to_end;
-      ++temp.block_it;
-
-      // Check if reached end
-      if (temp.block_it == temp.dq->blocks.end()) {
-        temp.block_it = dq->blocks.end();
-        temp.iter = typename double_list<T>::iterator();
-        return temp;
-      }
-
-      // Skip whole blocks
-      while (remain > 0 && temp.block_it != dq->blocks.end()) {
-        int block_size = temp.block_it->data.size();
-
-        if (remain >= block_size) {
-          remain -= block_size;
-          ++temp.block_it;
-
-          if (temp.block_it == temp.dq->blocks.end()) {
-            temp.block_it = dq->blocks.end();
-            temp.iter = typename double_list<T>::iterator();
-            return temp;
-          }
-        } else {
-          break;
-        }
-      }
-
-      // Final positioning within target block
-      if (temp.block_it != temp.dq->blocks.end()) {
-        temp.iter = temp.block_it->data.begin();
-        for (int i = 0; i < remain; i++)
-          ++temp;
-      }
-
-      return temp;
+      // Stay inside the current block when possible
+      if (block_it != dq->blocks.end() && idx + n < block_it->data.size())
+        return iterator(idx + n, block_it, dq);
+      return dq->iterator_at(dq->position_of(block_it, idx) + n);
     }
 
     /**
@@ -233,94 +384,14 @@ public:
         return *this;
       if (n < 0)
         return *this + (-n);
-
-      // Special case for end() iterator
-      if (block_it == dq->blocks.end()) {
-        if (dq->blocks.empty()) {
-          return *this;
-        }
-
-        // Calculate from end backwards
-        iterator end_copy = *this;
-        --end_copy.block_it;
-        end_copy.iter = end_copy.block_it->data.end();
-
-        int remain = n;
-        int elements_in_last_block = end_copy.block_it->data.size();
-
-        // If can complete within last block
-        if (remain <= elements_in_last_block) {
-          end_copy.iter = end_copy.block_it->data.end();
-          for (int i = 0; i < remain; i++) {
-            --end_copy.iter;
-          }
-          return end_copy;
-        }
-
-        // Need to cross blocks
-        remain -= elements_in_last_block;
-
-        // Move to previous blocks
-        while (remain > 0 && end_copy.block_it != dq->blocks.begin()) {
-          --end_copy.block_it;
-          int block_size = end_copy.block_it->data.size();
-
-          if (remain > block_size) {
-            remain -= block_size;
-          } else {
-            end_copy.iter = end_copy.block_it->data.end();
-            for (int i = 0; i < remain; i++) {
-              --end_copy.iter;
-            }
-            return end_copy;
-          }
-        }
-
-        end_copy.iter = end_copy.block_it->data.begin();
-        return end_copy;
-      }
-
-      iterator temp = *this;
-      int remain = n;
-
-      // Calculate elements from current position to block start
-      int current_pos = 0;
-      auto it_copy = temp.iter;
-      auto block_begin = temp.block_it->data.begin();
-      while (it_copy != block_begin) {
-        --it_copy;
-        ++current_pos;
-      }
-
-      // If can complete within current block
-      if (remain <= current_pos) {
-        for (int i = 0; i < remain; i++)
-          --temp.iter;
-        return temp;
-      }
-
-      // Need to cross blocks
-      remain -= current_pos;
-
-      // Move to previous blocks
-      while (remain > 0 && temp.block_it != dq->blocks.begin()) {
-        --temp.block_it;
-        int block_size = temp.block_it->data.size();
-
-        if (remain > block_size) {
-          remain -= block_size;
-        } else {
-          temp.iter = temp.block_it->data.end();
-          for (int i = 0; i < remain; i++) {
-            --temp.iter;
-          }
-          return temp;
-        }
-      }
-
-      // Position at first block's beginning
-      temp.iter = temp.block_it->data.begin();
-      return temp;
+      lookup_probe probe(*dq, &deque_stats::jump_calls,
+                         &deque_stats::jump_blocks_visited);
+
+      // Stay inside the current block when possible
+      if ((size_t)n <= idx)
+        return iterator(idx - n, block_it, dq);
+      size_t pos = dq->position_of(block_it, idx);
+      return dq->iterator_at(pos > (size_t)n ? pos - n : 0);
     }
 
     /**
@@ -331,50 +402,13 @@ public:
     int operator-(const iterator &rhs) const {
       if (dq != rhs.dq)
         throw invalid_iterator();
-
-      // Both are end()
-      if (block_it == dq->blocks.end() && rhs.block_it == dq->blocks.end())
-        return 0;
-
-      // Calculate this iterator's position
-      int this_pos = 0;
-      if (block_it != dq->blocks.end()) {
-        auto curr_block = dq->blocks.begin();
-        while (curr_block != block_it) {
-          this_pos += curr_block->data.size();
-          ++curr_block;
-        }
-
-        auto curr_iter = block_it->data.begin();
-        while (curr_iter != iter) {
-          ++this_pos;
-          ++curr_iter;
-        }
-      } else {
-        this_pos = dq->size();
-      }
-
-      // Calculate rhs iterator's position
-      int rhs_pos = 0;
-      if (rhs.block_it != dq->blocks.end()) {
-        auto curr_block = dq->blocks.begin();
-        while (curr_block != rhs.block_it) {
-          rhs_pos += curr_block->data.size();
-          ++curr_block;
-        }
-
-        auto curr_iter = rhs.block_it->data.begin();
-        while (curr_iter != rhs.iter) {
-          ++rhs_pos;
-          ++curr_iter;
-        }
-      } else {
-        rhs_pos = dq->size();
-      }
-
-      return this_pos - rhs_pos;
+      return (int)dq->position_of(block_it, idx) -
+             (int)dq->position_of(rhs.block_it, rhs.idx);
     }
 
+    // Subscript relative to this iterator
+    T &operator[](const int &n) const { return *(*this + n); }
+
     // Compound addition assignment
     iterator &operator+=(const int &n) {
       *this = *this + n;
@@ -389,11 +423,17 @@ public:
 
     // Equality comparison
     bool operator==(const iterator &rhs) const {
-      return block_it == rhs.block_it && iter == rhs.iter;
+      return block_it == rhs.block_it && idx == rhs.idx;
     }
 
     // Inequality comparison
     bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+
+    // Ordering comparisons by global position
+    bool operator<(const iterator &rhs) const { return *this - rhs < 0; }
+    bool operator>(const iterator &rhs) const { return *this - rhs > 0; }
+    bool operator<=(const iterator &rhs) const { return *this - rhs <= 0; }
+    bool operator>=(const iterator &rhs) const { return *this - rhs >= 0; }
   };
 
   // Const iterator class for deque
@@ -402,36 +442,32 @@ public:
     friend class iterator;
 
   private:
-    typename double_list<block>::const_iterator block_it;
-    typename double_list<T>::const_iterator iter;
+    const_block_iterator block_it;
+    size_t idx;
     const deque *dq;
 
   public:
-    const_iterator() {}
-    const_iterator(typename double_list<T>::const_iterator iter,
-                   typename double_list<block>::const_iterator b_it,
-                   const deque *dq)
-        : iter(iter), block_it(b_it), dq(dq) {}
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef int difference_type;
+    typedef const T *pointer;
+    typedef const T &reference;
+
+    const_iterator() : idx(0), dq(nullptr) {}
+    const_iterator(size_t idx, const_block_iterator b_it, const deque *dq)
+        : block_it(b_it), idx(idx), dq(dq) {}
 
     // Conversion from iterator to const_iterator
     const_iterator(const iterator &it)
-        : iter(it.iter), block_it(it.block_it), dq(it.dq) {}
+        : block_it(it.block_it.dl, it.block_it.ptr), idx(it.idx), dq(it.dq) {}
 
     // Prefix increment
     const_iterator &operator++() {
-      if (iter != block_it->data.cend()) {
-        ++iter;
-        if (iter == block_it->data.cend()) {
-          ++block_it;
-          if (block_it != dq->blocks.cend()) {
-            iter = block_it->data.cbegin();
-          }
-        }
-      } else {
+      if (block_it == dq->blocks.cend())
+        throw invalid_iterator();
+      if (++idx == block_it->data.size()) {
         ++block_it;
-        if (block_it != dq->blocks.cend()) {
-          iter = block_it->data.cbegin();
-        }
+        idx = 0;
       }
       return *this;
     }
@@ -445,19 +481,13 @@ public:
 
     // Prefix decrement
     const_iterator &operator--() {
-      if (block_it == dq->blocks.cend()) {
-        --block_it;
-        iter = block_it->data.cend();
-      }
-      if (iter == block_it->data.cbegin()) {
-        if (block_it != dq->blocks.cbegin()) {
-          --block_it;
-          iter = block_it->data.cend();
-        } else {
+      if (idx == 0) {
+        if (block_it == dq->blocks.cbegin())
           throw invalid_iterator();
-        }
+        --block_it;
+        idx = block_it->data.size();
       }
-      --iter;
+      --idx;
       return *this;
     }
 
@@ -469,10 +499,14 @@ public:
     }
 
     // Dereference operator
-    const T &operator*() const { return *iter; }
+    const T &operator*() const {
+      if (block_it == dq->blocks.cend())
+        throw invalid_iterator();
+      return block_it->data[idx];
+    }
 
     // Arrow operator
-    const T *operator->() const noexcept { return &(*iter); }
+    const T *operator->() const noexcept { return &block_it->data[idx]; }
 
     // Addition operator (similar to iterator's version)
     const_iterator operator+(const int &n) const {
@@ -480,56 +514,12 @@ public:
         return *this;
       if (n < 0)
         return *this - (-n);
+      lookup_probe probe(*dq, &deque_stats::jump_calls,
+                         &deque_stats::jump_blocks_visited);
 
-      const_iterator temp = *this;
-      int remain = n;
-
-      int elements_to_end = 0;
-      auto it_copy = temp.iter;
-      auto block_end = temp.block_it->data.cend();
-      while (it_copy != block_end) {
-        ++it_copy;
-        ++elements_to_end;
-      }
-
-      if (remain < elements_to_end) {
-        for (int i = 0; i < remain; i++)
-          ++temp;
-        return temp;
-      }
-
-      remain -= elements_to_end;
-      ++temp.block_it;
-      if (temp.block_it == temp.dq->blocks.cend()) {
-        temp.block_it = dq->blocks.cend();
-        temp.iter = typename double_list<T>::const_iterator();
-        return temp;
-      }
-
-      while (remain > 0 && temp.block_it != dq->blocks.cend()) {
-        int block_size = temp.block_it->data.size();
-
-        if (remain >= block_size) {
-          remain -= block_size;
-          ++temp.block_it;
-
-          if (temp.block_it == temp.dq->blocks.cend()) {
-            temp.block_it = dq->blocks.cend();
-            temp.iter = typename double_list<T>::const_iterator();
-            return temp;
-          }
-        } else {
-          break;
-        }
-      }
-
-      if (temp.block_it != temp.dq->blocks.cend()) {
-        temp.iter = temp.block_it->data.cbegin();
-        for (int i = 0; i < remain; i++)
-          ++temp;
-      }
-
-      return temp;
+      if (block_it != dq->blocks.cend() && idx + n < block_it->data.size())
+        return const_iterator(idx + n, block_it, dq);
+      return dq->const_iterator_at(dq->position_of(block_it, idx) + n);
     }
 
     // Subtraction operator (similar to iterator's version)
@@ -538,171 +528,379 @@ public:
         return *this;
       if (n < 0)
         return *this + (-n);
+      lookup_probe probe(*dq, &deque_stats::jump_calls,
+                         &deque_stats::jump_blocks_visited);
 
-      const_iterator begin = dq->cbegin();
+      if ((size_t)n <= idx)
+        return const_iterator(idx - n, block_it, dq);
+      size_t pos = dq->position_of(block_it, idx);
+      return dq->const_iterator_at(pos > (size_t)n ? pos - n : 0);
+    }
 
-      // Special case for end() iterator
-      if (block_it == dq->blocks.cend()) {
-        if (dq->blocks.empty()) {
-          return *this;
-        }
+    // Distance calculation (similar to iterator's version)
+    int operator-(const const_iterator &rhs) const {
+      if (dq != rhs.dq)
+        throw invalid_iterator();
+      return (int)dq->position_of(block_it, idx) -
+             (int)dq->position_of(rhs.block_it, rhs.idx);
+    }
 
-        const_iterator end_copy = *this;
-        --end_copy.block_it;
-        end_copy.iter = end_copy.block_it->data.cend();
+    // Subscript relative to this iterator
+    const T &operator[](const int &n) const { return *(*this + n); }
 
-        int remain = n;
-        int elements_in_last_block = end_copy.block_it->data.size();
+    // Compound addition assignment
+    const_iterator &operator+=(const int &n) {
+      *this = *this + n;
+      return *this;
+    }
 
-        if (remain <= elements_in_last_block) {
-          end_copy.iter = end_copy.block_it->data.cend();
-          for (int i = 0; i < remain; i++) {
-            --end_copy.iter;
-          }
-          return end_copy;
-        }
+    // Compound subtraction assignment
+    const_iterator &operator-=(const int &n) {
+      *this = *this - n;
+      return *this;
+    }
 
-        remain -= elements_in_last_block;
+    // Equality comparison
+    bool operator==(const const_iterator &rhs) const {
+      return block_it == rhs.block_it && idx == rhs.idx;
+    }
 
-        while (remain > 0 && end_copy.block_it != dq->blocks.cbegin()) {
-          --end_copy.block_it;
-          int block_size = end_copy.block_it->data.size();
+    // Inequality comparison
+    bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
 
-          if (remain > block_size) {
-            remain -= block_size;
-          } else {
-            end_copy.iter = end_copy.block_it->data.cend();
-            for (int i = 0; i < remain; i++) {
-              --end_copy.iter;
-            }
-            return end_copy;
-          }
-        }
+    // Ordering comparisons by global position
+    bool operator<(const const_iterator &rhs) const { return *this - rhs < 0; }
+    bool operator>(const const_iterator &rhs) const { return *this - rhs > 0; }
+    bool operator<=(const const_iterator &rhs) const {
+      return *this - rhs <= 0;
+    }
+    bool operator>=(const const_iterator &rhs) const {
+      return *this - rhs >= 0;
+    }
+  };
 
-        end_copy.iter = end_copy.block_it->data.cbegin();
-        return end_copy;
-      }
+  // A maximal run of elements stored contiguously, [first, last)
+  template <class Ptr> struct basic_segment {
+    Ptr first;
+    Ptr last;
 
-      const_iterator temp = *this;
-      int remain = n;
+    Ptr begin() const { return first; }
+    Ptr end() const { return last; }
+    size_t size() const { return last - first; }
+  };
 
-      int current_pos = 0;
-      auto it_copy = temp.iter;
-      auto block_begin = temp.block_it->data.cbegin();
-      while (it_copy != block_begin) {
-        --it_copy;
-        ++current_pos;
-      }
+  typedef basic_segment<T *> segment;
+  typedef basic_segment<const T *> const_segment;
 
-      if (remain <= current_pos) {
-        for (int i = 0; i < remain; i++)
-          --temp.iter;
-        return temp;
-      }
+  /**
+   * Forward iterator over the segments of a deque, in element order. Each
+   * block contributes one or two segments, depending on whether its ring
+   * buffer wraps. Invalidated by any insertion or erasure.
+   */
+  template <class Segment, class BlockIter> class basic_segment_iterator {
+  private:
+    BlockIter block_it;
+    size_t run; // Which contiguous run of the block
 
-      remain -= current_pos;
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Segment value_type;
+    typedef int difference_type;
+    typedef const Segment *pointer;
+    typedef Segment reference;
 
-      while (remain > 0 && temp.block_it != dq->blocks.cbegin()) {
-        --temp.block_it;
-        int block_size = temp.block_it->data.size();
+    basic_segment_iterator(BlockIter b, size_t r) : block_it(b), run(r) {}
 
-        if (remain > block_size) {
-          remain -= block_size;
-        } else {
-          temp.iter = temp.block_it->data.cend();
-          for (int i = 0; i < remain; i++) {
-            --temp.iter;
-          }
-          return temp;
-        }
+    Segment operator*() const {
+      auto first = block_it->data.run_data(run);
+      return Segment{first, first + block_it->data.run_size(run)};
+    }
+
+    basic_segment_iterator &operator++() {
+      if (run + 1 < block_it->data.runs()) {
+        ++run;
+      } else {
+        ++block_it;
+        run = 0;
       }
+      return *this;
+    }
 
-      temp.iter = temp.block_it->data.cbegin();
-      return temp;
+    basic_segment_iterator operator++(int) {
+      basic_segment_iterator tmp = *this;
+      ++*this;
+      return tmp;
     }
 
-    // Distance calculation (similar to iterator's version)
-    int operator-(const const_iterator &rhs) const {
-      if (dq != rhs.dq)
-        throw invalid_iterator();
+    bool operator==(const basic_segment_iterator &rhs) const {
+      return block_it == rhs.block_it && run == rhs.run;
+    }
+    bool operator!=(const basic_segment_iterator &rhs) const {
+      return !(*this == rhs);
+    }
+  };
 
-      if (block_it == dq->blocks.cend() && rhs.block_it == dq->blocks.cend())
-        return 0;
+  typedef basic_segment_iterator<segment, block_iterator> segment_iterator;
+  typedef basic_segment_iterator<const_segment, const_block_iterator>
+      const_segment_iterator;
 
-      int this_pos = 0;
-      if (block_it != dq->blocks.cend()) {
-        auto curr_block = dq->blocks.cbegin();
-        while (curr_block != block_it) {
-          this_pos += curr_block->data.size();
-          ++curr_block;
-        }
+  // Range of segments, usable in a range-based for loop
+  template <class Iter> struct segment_range {
+    Iter first;
+    Iter last;
 
-        auto curr_iter = block_it->data.cbegin();
-        while (curr_iter != iter) {
-          ++this_pos;
-          ++curr_iter;
-        }
-      } else {
-        this_pos = dq->size();
-      }
+    Iter begin() const { return first; }
+    Iter end() const { return last; }
+  };
 
-      int rhs_pos = 0;
-      if (rhs.block_it != dq->blocks.cend()) {
-        auto curr_block = dq->blocks.cbegin();
-        while (curr_block != rhs.block_it) {
-          rhs_pos += curr_block->data.size();
-          ++curr_block;
-        }
+private:
+  /**
+   * Global position of the element at index idx of block b_it, read from
+   * the block's ordinal and the index prefix sums in O(log B)
+   * @return Number of elements before that element
+   */
+  size_t position_of(const_block_iterator b_it, size_t idx) const {
+    if (b_it == blocks.cend())
+      return total_size;
+    refresh_index();
+    return index.prefix(b_it->ordinal) + idx;
+  }
 
-        auto curr_iter = rhs.block_it->data.cbegin();
-        while (curr_iter != rhs.iter) {
-          ++rhs_pos;
-          ++curr_iter;
-        }
-      } else {
-        rhs_pos = dq->size();
+  /**
+   * Make the blocks of this deque a copy of other's. Existing blocks are
+   * reused and missing ones allocated with other's capacities before any
+   * element is copied, so the copy loop itself never allocates.
+   */
+  void copy_blocks(const deque &other) {
+    index.invalidate();
+    total_size = 0;
+    while (blocks.size() > other.blocks.size())
+      blocks.pop_back();
+    try {
+      auto src = other.blocks.cbegin();
+      for (auto dst = blocks.begin(); dst != blocks.end(); ++dst, ++src) {
+        dst->data.clear();
+        dst->data.reserve(src->data.size());
       }
+      for (; src != other.blocks.cend(); ++src)
+        blocks.emplace_tail(src->data.capacity(), alloc);
 
-      return this_pos - rhs_pos;
+      src = other.blocks.cbegin();
+      for (auto dst = blocks.begin(); dst != blocks.end(); ++dst, ++src) {
+        dst->data = src->data;
+        total_size += dst->data.size();
+      }
+    } catch (...) {
+      clear();
+      throw;
     }
+  }
 
-    // Compound addition assignment
-    const_iterator &operator+=(const int &n) {
-      *this = *this + n;
-      return *this;
-    }
+  // Source for pack_range yielding the same value on every step
+  struct repeat_source {
+    const T *value;
+    const T &operator*() const { return *value; }
+    repeat_source &operator++() { return *this; }
+  };
 
-    // Compound subtraction assignment
-    const_iterator &operator-=(const int &n) {
-      *this = *this - n;
-      return *this;
+  /**
+   * Append n elements read from src to the back of list, filling each block
+   * to fill elements with no per-element split or merge checks
+   * @param counter Incremented per element so it stays exact on exceptions
+   */
+  template <class Source>
+  void pack_range(block_list &list, Source &src, size_t n, size_t fill,
+                  size_t &counter) {
+    while (n > 0) {
+      if (list.empty() || list.back().data.size() >= fill)
+        list.emplace_tail(fill + 1, alloc);
+      auto &data = list.back().data;
+      if (data.capacity() < fill)
+        data.reserve(fill + 1);
+      try {
+        for (; n > 0 && data.size() < fill; --n, ++src, ++counter)
+          data.emplace_back(*src);
+      } catch (...) {
+        if (data.empty())
+          list.pop_back();
+        throw;
+      }
     }
+  }
 
-    // Equality comparison
-    bool operator==(const const_iterator &rhs) const {
-      return block_it == rhs.block_it && iter == rhs.iter;
+  size_t position_of(block_iterator b_it, size_t idx) const {
+    return position_of(const_block_iterator(&blocks, b_it.ptr), idx);
+  }
+
+  // Single-pass ranges cannot be counted up front, so push one by one
+  template <class InputIt>
+  void append_range(InputIt first, InputIt last, std::input_iterator_tag) {
+    for (; first != last; ++first)
+      emplace_back(*first);
+  }
+
+  template <class ForwardIt>
+  void append_range(ForwardIt first, ForwardIt last,
+                    std::forward_iterator_tag) {
+    size_t n = std::distance(first, last);
+    if (n == 0)
+      return;
+    index.invalidate();
+    pack_range(blocks, first, n, max_block_size_for(total_size + n),
+               total_size);
+  }
+
+  // Buffer a single-pass range so it can be counted, then move it in
+  template <class InputIt>
+  iterator insert_range(iterator pos, InputIt first, InputIt last,
+                        std::input_iterator_tag) {
+    deque buffered(alloc);
+    buffered.append_range(first, last);
+    return insert_range(pos, std::make_move_iterator(buffered.begin()),
+                        std::make_move_iterator(buffered.end()),
+                        std::forward_iterator_tag());
+  }
+
+  template <class ForwardIt>
+  iterator insert_range(iterator pos, ForwardIt first, ForwardIt last,
+                        std::forward_iterator_tag) {
+    size_t n = std::distance(first, last);
+    if (n == 0)
+      return pos;
+    size_t p = position_of(pos.block_it, pos.idx);
+    if (pos == end()) {
+      append_range(first, last);
+      return iterator_at(p);
+    }
+    index.invalidate();
+
+    // Block that will sit in front of the range, for the seam merge below
+    bool has_before = pos.idx > 0 || pos.block_it != blocks.begin();
+    block_iterator before = pos.block_it;
+    if (pos.idx == 0 && has_before)
+      --before;
+
+    // Cut the block holding pos so the range goes between its two halves
+    block_iterator next = pos.block_it;
+    if (pos.idx > 0) {
+      ++next;
+      next = blocks.emplace(next, new_block_capacity(), alloc);
+      next->data.splice(pos.block_it->data, pos.idx);
     }
 
-    // Inequality comparison
-    bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
-  };
+    block_list packed{block_allocator(alloc)};
+    size_t added = 0;
+    pack_range(packed, first, n, max_block_size_for(total_size + n), added);
+    blocks.splice(next, packed, packed.begin(), packed.end());
+    total_size += added;
+
+    // Close the seams on both sides of the inserted blocks
+    auto last_new = next;
+    --last_new;
+    join_seam(last_new);
+    if (has_before)
+      join_seam(before);
+    return iterator_at(p);
+  }
+
+  // Iterator to global position pos, or end() if pos is past the last element
+  iterator iterator_at(size_t pos) {
+    if (pos >= total_size)
+      return end();
+    auto it = locate(pos);
+    return iterator(pos, it, this);
+  }
+
+  const_iterator const_iterator_at(size_t pos) const {
+    if (pos >= total_size)
+      return cend();
+    auto it = locate(pos);
+    return const_iterator(pos, const_block_iterator(&blocks, it.ptr), this);
+  }
 
+public:
   // Default constructor
-  deque() : total_size(0) {}
+  deque() : blocks(block_allocator(alloc)), total_size(0) {}
+
+  /**
+   * Construct an empty deque allocating through a
+   * @param a Allocator for elements; block list nodes use a rebound copy
+   */
+  explicit deque(const Alloc &a)
+      : alloc(a), blocks(block_allocator(a)), total_size(0) {}
+
+  /**
+   * Construct a deque whose block list nodes come from the calling thread's
+   * shared node pool, so many short-lived deques on one thread recycle the
+   * same slabs. The deque must not outlive the thread.
+   */
+  explicit deque(thread_pool_t) : blocks(thread_pool), total_size(0) {}
+
+  /**
+   * Construct a deque holding n copies of value
+   * @param n Number of elements
+   * @param value Value to copy
+   */
+  deque(size_t n, const T &value, const Alloc &a = Alloc())
+      : alloc(a), blocks(block_allocator(a)), total_size(0) {
+    assign(n, value);
+  }
+
+  /**
+   * Construct a deque from the range [first, last)
+   * @param first Iterator to the first element
+   * @param last Iterator past the last element
+   */
+  template <class InputIt, class = typename std::enable_if<
+                               !std::is_integral<InputIt>::value>::type>
+  deque(InputIt first, InputIt last, const Alloc &a = Alloc())
+      : alloc(a), blocks(block_allocator(a)), total_size(0) {
+    append_range(first, last);
+  }
 
   // Copy constructor
-  deque(const deque &other) : total_size(other.total_size) {
-    blocks = other.blocks;
+  deque(const deque &other)
+      : alloc(std::allocator_traits<Alloc>::
+                  select_on_container_copy_construction(other.alloc)),
+        blocks(block_allocator(alloc)), total_size(0) {
+    copy_blocks(other);
+  }
+
+  // Move constructor, takes over other's blocks without touching elements
+  deque(deque &&other) noexcept
+      : alloc(other.alloc), blocks(std::move(other.blocks)),
+        total_size(other.total_size) {
+    other.total_size = 0;
+    other.index.invalidate();
   }
 
   // Destructor
   ~deque() { clear(); }
 
+  // Get a copy of the element allocator
+  Alloc get_allocator() const { return alloc; }
+
   // Assignment operator
   deque &operator=(const deque &other) {
+    if (this != &other)
+      copy_blocks(other);
+    return *this;
+  }
+
+  // Move assignment operator
+  deque &operator=(deque &&other) noexcept {
     if (this != &other) {
+      // Spares come along with the allocator that made them, and the old
+      // ones go back to the allocator being replaced
+      front_spares = std::move(other.front_spares);
+      back_spares = std::move(other.back_spares);
+      set_spare_block_limit(spare_limit);
+      alloc = other.alloc;
+      blocks = std::move(other.blocks);
       total_size = other.total_size;
-      blocks = other.blocks;
+      index.invalidate();
+      other.total_size = 0;
+      other.index.invalidate();
     }
     return *this;
   }
@@ -716,46 +914,32 @@ public:
   T &at(const size_t &pos) {
     if (pos >= total_size)
       throw index_out_of_bound();
-    auto it = blocks.begin();
-    size_t count = 0;
-    while (it != blocks.end()) {
-      if (count + it->data.size() > pos) {
-        auto data_it = it->data.begin();
-        for (size_t i = 0; i < pos - count; ++i) {
-          ++data_it;
-        }
-        return *data_it;
-      }
-      count += it->data.size();
-      ++it;
-    }
-    throw index_out_of_bound();
+    lookup_probe probe(*this, &deque_stats::at_calls,
+                       &deque_stats::at_blocks_visited);
+    size_t offset = pos;
+    auto it = locate(offset);
+    return it->data[offset];
   }
 
-  // Const version of at()
+  /**
+   * Const version of at(). Rebuilds the block index if a structural change
+   * left it stale, so concurrent const readers are only safe once a lookup
+   * has run since the last modification
+   */
   const T &at(const size_t &pos) const {
     if (pos >= total_size)
       throw index_out_of_bound();
-    auto it = blocks.cbegin();
-    size_t count = 0;
-    while (it != blocks.cend()) {
-      if (count + it->data.size() > pos) {
-        auto data_it = it->data.cbegin();
-        for (size_t i = 0; i < pos - count; ++i) {
-          ++data_it;
-        }
-        return *data_it;
-      }
-      count += it->data.size();
-      ++it;
-    }
-    throw index_out_of_bound();
+    lookup_probe probe(*this, &deque_stats::at_calls,
+                       &deque_stats::at_blocks_visited);
+    size_t offset = pos;
+    auto it = locate(offset);
+    return it->data[offset];
   }
 
   // Subscript operator
   T &operator[](const size_t &pos) { return at(pos); }
 
-  // Const subscript operator
+  // Const subscript operator; the same thread-safety caveat as at() const
   const T &operator[](const size_t &pos) const { return at(pos); }
 
   /**
@@ -773,7 +957,7 @@ public:
   const T &front() const {
     if (total_size == 0)
       throw container_is_empty();
-    return blocks.cfront().data.cfront();
+    return blocks.cfront().data.front();
   }
 
   /**
@@ -791,32 +975,22 @@ public:
   const T &back() const {
     if (total_size == 0)
       throw container_is_empty();
-    return blocks.cback().data.cback();
+    return blocks.cback().data.back();
   }
 
   // Get iterator to beginning
-  iterator begin() {
-    if (blocks.empty())
-      return end();
-    return iterator(blocks.begin()->data.begin(), blocks.begin(), this);
-  }
+  iterator begin() { return iterator(0, blocks.begin(), this); }
 
   // Get const iterator to beginning
   const_iterator cbegin() const {
-    return const_iterator(blocks.cbegin()->data.cbegin(), blocks.cbegin(),
-                          this);
+    return const_iterator(0, blocks.cbegin(), this);
   }
 
   // Get iterator to end
-  iterator end() {
-    return iterator(typename double_list<T>::iterator(), blocks.end(), this);
-  }
+  iterator end() { return iterator(0, blocks.end(), this); }
 
   // Get const iterator to end
-  const_iterator cend() const {
-    return const_iterator(typename double_list<T>::const_iterator(),
-                          blocks.cend(), this);
-  }
+  const_iterator cend() const { return const_iterator(0, blocks.cend(), this); }
 
   // Check if deque is empty
   bool empty() const { return total_size == 0; }
@@ -824,10 +998,193 @@ public:
   // Get number of elements
   size_t size() const { return total_size; }
 
-  // Clear all elements
+  /**
+   * Operation counters and current block structure. The counters stay zero
+   * unless SJTU_DEQUE_STATS is defined; the structure is measured in O(B).
+   */
+  deque_stats stats() const {
+    deque_stats s;
+#ifdef SJTU_DEQUE_STATS
+    s = counters;
+    s.counting = true;
+#endif
+    s.node_allocations = blocks.created_nodes();
+    s.node_frees = blocks.destroyed_nodes();
+    s.size = total_size;
+    s.blocks = blocks.size();
+    s.min_block_size = min_block_size();
+    s.max_block_size = max_block_size();
+    bool first = true;
+    for (auto it = blocks.cbegin(); it != blocks.cend(); ++it) {
+      size_t n = it->data.size();
+      if (n < s.min_block_size)
+        ++s.small_blocks;
+      if (first || n < s.smallest_block)
+        s.smallest_block = n;
+      if (n > s.largest_block)
+        s.largest_block = n;
+      first = false;
+      size_t bucket = n * deque_stats::fill_buckets / s.max_block_size;
+      if (bucket >= deque_stats::fill_buckets)
+        bucket = deque_stats::fill_buckets - 1;
+      ++s.fill_histogram[bucket];
+    }
+    return s;
+  }
+
+  // Bytes held by the deque, split into payload and each kind of overhead
+  deque_memory memory_usage() const {
+    deque_memory m;
+    m.container = sizeof(deque);
+    size_t slots = 0;
+    for (auto it = blocks.cbegin(); it != blocks.cend(); ++it)
+      slots += it->data.capacity();
+    m.payload = total_size * sizeof(T);
+    m.slack = (slots - total_size) * sizeof(T);
+    m.block_headers = blocks.size() * sizeof(block);
+    m.node_links = blocks.size() * (block_list::node_bytes() - sizeof(block));
+    m.index = index.memory_bytes();
+    const spare_stack *ends[] = {&front_spares, &back_spares};
+    for (const spare_stack *spares : ends) {
+      m.spares += spares->capacity() * sizeof(buffer);
+      for (size_t i = 0; i < spares->size(); ++i)
+        m.spares += (*spares)[i].capacity() * sizeof(T);
+    }
+    return m;
+  }
+
+  // Contiguous segments holding the elements, in order
+  segment_range<segment_iterator> segments() {
+    return {segment_iterator(blocks.begin(), 0),
+            segment_iterator(blocks.end(), 0)};
+  }
+
+  segment_range<const_segment_iterator> segments() const {
+    return {const_segment_iterator(blocks.cbegin(), 0),
+            const_segment_iterator(blocks.cend(), 0)};
+  }
+
+  /**
+   * Call f(first, last) for every contiguous segment of elements, in order,
+   * so f can run a tight loop over plain pointers
+   * @param f Callable taking (T *first, T *last)
+   * @return f
+   */
+  template <class F> F for_each_segment(F f) {
+    for (segment seg : segments())
+      f(seg.first, seg.last);
+    return f;
+  }
+
+  // Call f(first, last) with const pointers for every segment
+  template <class F> F for_each_segment(F f) const {
+    for (const_segment seg : segments())
+      f(seg.first, seg.last);
+    return f;
+  }
+
+  // Clear all elements and release spare block storage
   void clear() {
     blocks.clear();
+    release_spares();
     total_size = 0;
+    index.invalidate();
+  }
+
+  /**
+   * Make sure the next n push_front calls do not allocate block storage,
+   * by keeping enough empty blocks in reserve at the front
+   * @param n Number of elements to make room for
+   */
+  void reserve_front(size_t n) {
+    reserve_end(n, blocks.empty() ? nullptr : &blocks.front(), front_spares);
+  }
+
+  /**
+   * Make sure the next n push_back calls do not allocate block storage,
+   * by keeping enough empty blocks in reserve at the back
+   * @param n Number of elements to make room for
+   */
+  void reserve_back(size_t n) {
+    reserve_end(n, blocks.empty() ? nullptr : &blocks.back(), back_spares);
+  }
+
+  // Maximum number of emptied blocks kept for reuse at each end
+  size_t spare_block_limit() const { return spare_limit; }
+
+  /**
+   * Set how many emptied blocks each end keeps for reuse. Spares beyond
+   * the new limit, including reserved ones, are released.
+   * @param n Blocks kept per end, 0 to free emptied blocks immediately
+   */
+  void set_spare_block_limit(size_t n) {
+    spare_limit = n;
+    while (front_spares.size() > n)
+      front_spares.pop_back();
+    while (back_spares.size() > n)
+      back_spares.pop_back();
+  }
+
+  /**
+   * Repack the elements into blocks filled to the maximum block size,
+   * leaving at most the last block partly filled. Blocks left underfilled
+   * by middle erases are merged away; leading full blocks are kept as they
+   * are. O(n) element moves, one block of extra storage at a time.
+   * Invalidates all iterators.
+   * @throw Whatever allocation or T's move constructor throws; the elements
+   * and their order are unchanged then, only partly repacked
+   */
+  void compact() {
+    size_t fill = max_block_size();
+    block_iterator src = blocks.begin();
+    // Full blocks at the front are already packed
+    while (src != blocks.end() && src->data.size() == fill)
+      ++src;
+    if (src == blocks.end())
+      return;
+    index.invalidate();
+    // Packed blocks are built in front of src, so the list stays in element
+    // order if a move throws
+    block_iterator dst = blocks.end();
+    try {
+      while (src != blocks.end()) {
+        while (!src->data.empty()) {
+          if (dst == blocks.end() || dst->data.size() == fill)
+            dst = blocks.emplace(src, fill + 1, alloc);
+          size_t k = std::min(src->data.size(), fill - dst->data.size());
+          for (; k > 0; --k) {
+            dst->data.emplace_back(std::move(src->data.front()));
+            src->data.pop_front();
+          }
+        }
+        src = blocks.erase(src);
+      }
+    } catch (...) {
+      // A block linked just before the failed move is still empty
+      if (dst != blocks.end() && dst->data.empty())
+        blocks.erase(dst);
+      throw;
+    }
+  }
+
+  /**
+   * Release all memory not holding elements: compact the blocks, trim each
+   * block's storage to one slot above its size, and free the spare blocks
+   * and the block index. Invalidates all iterators.
+   * @throw Whatever allocation or T's move constructor throws
+   */
+  void shrink_to_fit() {
+    compact();
+    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+      if (it->data.capacity() <= it->data.size() + 1)
+        continue;
+      buffer tight(it->data.size() + 1, alloc);
+      tight.splice(it->data);
+      it->data = std::move(tight);
+    }
+    front_spares = spare_stack(spare_allocator(alloc));
+    back_spares = spare_stack(spare_allocator(alloc));
+    index.release();
   }
 
   /**
@@ -837,27 +1194,175 @@ public:
    * @return Iterator pointing to inserted element
    * @throw invalid_iterator if pos is invalid
    */
-  iterator insert(iterator pos, const T &value) {
+  iterator insert(iterator pos, const T &value) { return emplace(pos, value); }
+
+  // Insert by moving value into the deque
+  iterator insert(iterator pos, T &&value) {
+    return emplace(pos, std::move(value));
+  }
+
+  /**
+   * Construct element in place at specified position
+   * @param pos Iterator before which to construct
+   * @param args Constructor arguments for the new element
+   * @return Iterator pointing to the new element
+   * @throw invalid_iterator if pos is invalid
+   */
+  template <class... Args> iterator emplace(iterator pos, Args &&...args) {
     if (pos.dq != this)
       throw invalid_iterator();
     if (pos == begin()) {
-      push_front(value);
+      emplace_front(std::forward<Args>(args)...);
       return begin();
     }
     if (pos == end()) {
-      push_back(value);
+      emplace_back(std::forward<Args>(args)...);
       return --end();
     }
 
-    int offset = pos - begin();
-
-    auto new_data_iter = pos.block_it->data.insert(pos.iter, value);
+    auto current_block = pos.block_it;
+    current_block->data.emplace(pos.idx, std::forward<Args>(args)...);
     total_size++;
+    index.add(current_block->ordinal, 1);
 
     // Split current block if exceeds max size
-    split_block(pos.block_it);
+    size_t half = current_block->data.size() / 2;
+    if (current_block->data.size() > max_block_size()) {
+      split_block(current_block);
+      if (pos.idx >= half) {
+        ++current_block;
+        return iterator(pos.idx - half, current_block, this);
+      }
+    }
+    return iterator(pos.idx, current_block, this);
+  }
 
-    return begin() + offset;
+  /**
+   * Insert the range [first, last) before pos. The range is packed into
+   * fully sized blocks which are linked in between the two halves of the
+   * block holding pos, so only the seams are merged afterwards.
+   * @param pos Iterator before which to insert
+   * @return Iterator pointing to the first inserted element, or pos if the
+   * range is empty
+   * @throw invalid_iterator if pos is invalid
+   */
+  template <class InputIt, class = typename std::enable_if<
+                               !std::is_integral<InputIt>::value>::type>
+  iterator insert(iterator pos, InputIt first, InputIt last) {
+    if (pos.dq != this)
+      throw invalid_iterator();
+    return insert_range(pos, first, last,
+                        typename std::iterator_traits<
+                            InputIt>::iterator_category());
+  }
+
+  /**
+   * Replace the contents with the range [first, last)
+   * @param first Iterator to the first element
+   * @param last Iterator past the last element
+   */
+  template <class InputIt, class = typename std::enable_if<
+                               !std::is_integral<InputIt>::value>::type>
+  void assign(InputIt first, InputIt last) {
+    clear();
+    append_range(first, last);
+  }
+
+  /**
+   * Replace the contents with n copies of value
+   * @param n Number of elements
+   * @param value Value to copy
+   */
+  void assign(size_t n, const T &value) {
+    clear();
+    index.invalidate();
+    repeat_source src = {&value};
+    pack_range(blocks, src, n, max_block_size_for(n), total_size);
+  }
+
+  /**
+   * Append the range [first, last) at the end. Forward ranges are counted
+   * first so every block is sized for the final element count.
+   * @param first Iterator to the first element
+   * @param last Iterator past the last element
+   */
+  template <class InputIt> void append_range(InputIt first, InputIt last) {
+    append_range(first, last,
+                 typename std::iterator_traits<InputIt>::iterator_category());
+  }
+
+  /**
+   * Move every element of other to the end of this deque by relinking its
+   * blocks; only the two blocks meeting at the seam may be merged. Blocks
+   * are relinked node by node only if both deques share a node pool,
+   * otherwise each block object is moved, but elements never are.
+   * @param other Deque to drain, left empty
+   */
+  void append(deque &&other) {
+    if (&other == this || other.empty())
+      return;
+    auto seam = blocks.end();
+    if (!blocks.empty())
+      --seam;
+    blocks.splice(other.blocks);
+    total_size += other.total_size;
+    other.total_size = 0;
+    index.invalidate();
+    other.index.invalidate();
+    merge_blocks(seam);
+  }
+
+  /**
+   * Move every element of other to the front of this deque by relinking
+   * its blocks, like append()
+   * @param other Deque to drain, left empty
+   */
+  void prepend(deque &&other) {
+    if (&other == this || other.empty())
+      return;
+    auto old_first = blocks.begin();
+    blocks.splice(old_first, other.blocks, other.blocks.begin(),
+                  other.blocks.end());
+    total_size += other.total_size;
+    other.total_size = 0;
+    index.invalidate();
+    other.index.invalidate();
+    auto seam = old_first;
+    --seam;
+    merge_blocks(seam);
+  }
+
+  /**
+   * Cut the deque in two at pos. Only the block holding pos has elements
+   * moved. The result shares this deque's node pool when it uses an
+   * external one (e.g. sjtu::thread_pool), and whole blocks after pos are
+   * then relinked in O(1) each. Otherwise each block object moves into a
+   * new node, which transfers its storage without touching elements.
+   * @param pos Iterator to the first element of the tail
+   * @return Deque holding [pos, end()); this deque keeps [begin(), pos)
+   * @throw invalid_iterator if pos is invalid
+   */
+  deque split_at(iterator pos) {
+    if (pos.dq != this)
+      throw invalid_iterator();
+    deque tail(alloc);
+    if (auto *shared = blocks.shared_pool())
+      tail.blocks = block_list(*shared, block_allocator(alloc));
+    if (pos == end())
+      return tail;
+    size_t p = position_of(pos.block_it, pos.idx);
+    index.invalidate();
+
+    block_iterator first = pos.block_it;
+    if (pos.idx > 0) {
+      ++first;
+      first = blocks.emplace(first, new_block_capacity(), alloc);
+      first->data.splice(pos.block_it->data, pos.idx);
+    }
+    tail.blocks.splice(tail.blocks.end(), blocks, first, blocks.end());
+    tail.total_size = total_size - p;
+    total_size = p;
+    return tail;
   }
 
   /**
@@ -867,55 +1372,145 @@ public:
    * @throw invalid_iterator if pos is invalid
    */
   iterator erase(iterator pos) {
-    if (pos == end() || pos.dq != this)
+    if (pos.dq != this || pos == end())
       throw invalid_iterator();
     auto current_block = pos.block_it;
-    auto next = current_block->data.erase(pos.iter);
+    size_t idx = pos.idx;
+    current_block->data.erase(idx);
     total_size--;
+    index.add(current_block->ordinal, -1);
 
     if (current_block->data.empty()) {
       auto next_block = current_block;
       ++next_block;
       blocks.erase(current_block);
-      if (next_block != blocks.end()) {
-        return iterator(next_block->data.begin(), next_block, this);
-      } else {
-        return end();
+      index.invalidate();
+      return iterator(0, next_block, this);
+    }
+
+    // Merge with previous block if too small
+    if (current_block->data.size() < min_block_size() &&
+        current_block != blocks.begin()) {
+      auto prev_block = current_block;
+      --prev_block;
+      size_t prev_size = prev_block->data.size();
+      if (prev_size + current_block->data.size() <= max_block_size()) {
+        merge_blocks(prev_block);
+        current_block = prev_block;
+        idx += prev_size;
+      }
+    }
+
+    if (idx == current_block->data.size()) {
+      ++current_block;
+      idx = 0;
+    }
+    return iterator(idx, current_block, this);
+  }
+
+  /**
+   * Erase the elements in [first, last). Blocks covered entirely are
+   * unlinked in one list operation; only the two boundary blocks are
+   * trimmed, and their seam is merged if it fits.
+   * @return Iterator following the last removed element
+   * @throw invalid_iterator if first or last is invalid or first > last
+   */
+  iterator erase(iterator first, iterator last) {
+    if (first.dq != this || last.dq != this)
+      throw invalid_iterator();
+    size_t p = position_of(first.block_it, first.idx);
+    size_t q = position_of(last.block_it, last.idx);
+    if (p > q)
+      throw invalid_iterator();
+    if (p == q)
+      return last;
+    if (p == 0) {
+      erase_front(q);
+      return begin();
+    }
+    if (q == total_size) {
+      erase_back(q - p);
+      return end();
+    }
+
+    // Both ends lie strictly inside the deque, so last is a real element
+    // and first has a predecessor
+    total_size -= q - p;
+    index.invalidate();
+    block_iterator lo = first.block_it;
+    block_iterator hi = last.block_it;
+    if (lo == hi) {
+      lo->data.erase(first.idx, last.idx);
+      if (lo->data.size() < min_block_size() && lo != blocks.begin()) {
+        --lo;
+        merge_blocks(lo);
       }
     } else {
-      // Merge with previous block if too small
-      if (current_block->data.size() < min_block_size() &&
-          current_block != blocks.begin()) {
-        auto prev_block = current_block;
-        --prev_block;
-
-        size_t prev_size = prev_block->data.size();
-        size_t current_size = current_block->data.size();
-        size_t offset = 0;
-        for (auto it = current_block->data.begin(); it != next; it++)
-          offset++;
-
-        if (prev_block->data.size() + current_size <= max_block_size()) {
-          merge_blocks(prev_block);
-          // Recalculate iterator position after merge
-          auto new_iter = prev_block->data.begin();
-          for (auto i = 0; i < prev_size + offset; i++)
-            new_iter++;
-          next = new_iter;
-          current_block = prev_block;
-        }
+      block_iterator inner = lo;
+      if (first.idx > 0) {
+        lo->data.erase(first.idx, lo->data.size());
+        ++inner;
       }
+      hi->data.erase(0, last.idx);
+      blocks.erase(inner, hi);
+      block_iterator seam = hi;
+      --seam;
+      merge_blocks(seam);
+    }
+    return iterator_at(p);
+  }
 
-      if (next != current_block->data.end()) {
-        return iterator(next, current_block, this);
-      } else {
-        auto next_block = current_block;
-        ++next_block;
-        if (next_block != blocks.end()) {
-          return iterator(next_block->data.begin(), next_block, this);
-        } else {
-          return end();
-        }
+  /**
+   * Remove the first n elements, dropping fully covered blocks whole
+   * @param n Number of elements to remove
+   * @throw index_out_of_bound if n > size()
+   */
+  void erase_front(size_t n) {
+    if (n > total_size)
+      throw index_out_of_bound();
+    if (n == 0)
+      return;
+    total_size -= n;
+    index.invalidate();
+    while (n > 0 && n >= blocks.front().data.size()) {
+      n -= blocks.front().data.size();
+      blocks.front().data.clear();
+      retire_storage(blocks.front(), front_spares);
+      blocks.pop_front();
+    }
+    if (n > 0) {
+      blocks.front().data.erase(0, n);
+      if (blocks.front().data.size() < min_block_size())
+        merge_blocks(blocks.begin());
+    }
+  }
+
+  /**
+   * Remove the last n elements, dropping fully covered blocks whole
+   * @param n Number of elements to remove
+   * @throw index_out_of_bound if n > size()
+   */
+  void erase_back(size_t n) {
+    if (n > total_size)
+      throw index_out_of_bound();
+    if (n == 0)
+      return;
+    total_size -= n;
+    index.invalidate();
+    while (n > 0 && n >= blocks.back().data.size()) {
+      n -= blocks.back().data.size();
+      blocks.back().data.clear();
+      retire_storage(blocks.back(), back_spares);
+      blocks.pop_back();
+    }
+    if (n > 0) {
+      auto last_block = --blocks.end();
+      last_block->data.erase(last_block->data.size() - n,
+                             last_block->data.size());
+      if (last_block->data.size() < min_block_size() &&
+          last_block != blocks.begin()) {
+        --last_block;
+        merge_blocks(last_block);
       }
     }
   }
@@ -924,16 +1519,30 @@ public:
    * Add element to the end
    * @param value Element value to add
    */
-  void push_back(const T &value) {
-    if (blocks.empty() || blocks.back().data.size() >= max_block_size()) {
-      blocks.insert_tail(block{});
+  void push_back(const T &value) { emplace_back(value); }
+
+  // Add element to the end by moving value
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+
+  /**
+   * Construct element in place at the end
+   * @param args Constructor arguments for the new element
+   * @return Reference to the new element
+   */
+  template <class... Args> T &emplace_back(Args &&...args) {
+    if (blocks.empty() || blocks.back().data.size() >= max_block_size() ||
+        blocks.back().data.full()) {
+      blocks.emplace_tail(take_storage(back_spares, front_spares));
+      index.invalidate();
     }
     auto last_block = --blocks.end();
-    last_block->data.insert_tail(value);
+    last_block->data.emplace_back(std::forward<Args>(args)...);
     total_size++;
+    index.add(last_block->ordinal, 1);
     if (last_block->data.size() > max_block_size()) {
       split_block(last_block);
     }
+    return back();
   }
 
   /**
@@ -946,21 +1555,18 @@ public:
     auto last_block = --blocks.end();
     last_block->data.pop_back();
     total_size--;
+    index.add(last_block->ordinal, -1);
 
     // Merge with previous block if too small
     if (last_block->data.empty()) {
+      retire_storage(*last_block, back_spares);
       blocks.pop_back();
+      index.invalidate();
     } else if (last_block->data.size() < min_block_size() &&
                blocks.size() > 1) {
       auto prev_block = last_block;
       --prev_block;
-      if (prev_block->data.size() + last_block->data.size() <=
-          max_block_size()) {
-        prev_block->data.splice(prev_block->data.end(), last_block->data,
-                                last_block->data.begin(),
-                                last_block->data.end());
-        blocks.erase(last_block);
-      }
+      merge_blocks(prev_block);
     }
   }
 
@@ -968,16 +1574,30 @@ public:
    * Add element to the front
    * @param value Element value to add
    */
-  void push_front(const T &value) {
-    if (blocks.empty() || blocks.front().data.size() >= max_block_size()) {
-      blocks.insert_head(block{});
+  void push_front(const T &value) { emplace_front(value); }
+
+  // Add element to the front by moving value
+  void push_front(T &&value) { emplace_front(std::move(value)); }
+
+  /**
+   * Construct element in place at the front
+   * @param args Constructor arguments for the new element
+   * @return Reference to the new element
+   */
+  template <class... Args> T &emplace_front(Args &&...args) {
+    if (blocks.empty() || blocks.front().data.size() >= max_block_size() ||
+        blocks.front().data.full()) {
+      blocks.emplace_head(take_storage(front_spares, back_spares));
+      index.invalidate();
     }
     auto first_block = blocks.begin();
-    first_block->data.insert_head(value);
+    first_block->data.emplace_front(std::forward<Args>(args)...);
     total_size++;
+    index.add(first_block->ordinal, 1);
     if (first_block->data.size() > max_block_size()) {
       split_block(first_block);
     }
+    return front();
   }
 
   /**
@@ -991,23 +1611,16 @@ public:
     auto first_block = blocks.begin();
     first_block->data.pop_front();
     total_size--;
+    index.add(first_block->ordinal, -1);
 
     // Merge with next block if too small
     if (first_block->data.empty()) {
+      retire_storage(*first_block, front_spares);
       blocks.erase(first_block);
+      index.invalidate();
     } else if (first_block->data.size() < min_block_size() &&
                blocks.size() > 1) {
-      auto next_block = first_block;
-      ++next_block;
-      if (next_block != blocks.end()) {
-        if (first_block->data.size() + next_block->data.size() <=
-            max_block_size()) {
-          first_block->data.splice(first_block->data.end(), next_block->data,
-                                   next_block->data.begin(),
-                                   next_block->data.end());
-          blocks.erase(next_block);
-        }
-      }
+      merge_blocks(first_block);
     }
   }
 };
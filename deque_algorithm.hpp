@@ -0,0 +1,112 @@
+#ifndef SJTU_DEQUE_ALGORITHM_HPP
+#define SJTU_DEQUE_ALGORITHM_HPP
+
+#include "deque.hpp"
+#include <algorithm>
+
+namespace sjtu {
+
+/**
+ * Segmented algorithms over a whole deque. Each one walks the contiguous
+ * segments of the deque and runs a plain pointer loop inside each segment,
+ * so there is no block-boundary check per element and the inner loops can
+ * be vectorized.
+ */
+
+/**
+ * Apply f to every element in order
+ * @return f
+ */
+template <class T, class Alloc, class Policy, class F>
+F for_each(deque<T, Alloc, Policy> &d, F f) {
+  for (auto seg : d.segments())
+    for (T *p = seg.first; p != seg.last; ++p)
+      f(*p);
+  return f;
+}
+
+template <class T, class Alloc, class Policy, class F>
+F for_each(const deque<T, Alloc, Policy> &d, F f) {
+  for (auto seg : d.segments())
+    for (const T *p = seg.first; p != seg.last; ++p)
+      f(*p);
+  return f;
+}
+
+/**
+ * Copy every element to out, in order
+ * @return Iterator past the last element written
+ */
+template <class T, class Alloc, class Policy, class OutputIt>
+OutputIt copy(const deque<T, Alloc, Policy> &d, OutputIt out) {
+  for (auto seg : d.segments())
+    out = std::copy(seg.first, seg.last, out);
+  return out;
+}
+
+// Assign value to every element
+template <class T, class Alloc, class Policy>
+void fill(deque<T, Alloc, Policy> &d, const T &value) {
+  // value may be an element of d, so copy it before overwriting anything
+  const T v(value);
+  for (auto seg : d.segments())
+    std::fill(seg.first, seg.last, v);
+}
+
+/**
+ * Find the first element equal to value
+ * @return Iterator to that element, or end() if there is none
+ */
+template <class T, class Alloc, class Policy>
+typename deque<T, Alloc, Policy>::iterator find(deque<T, Alloc, Policy> &d,
+                                                const T &value) {
+  size_t pos = 0;
+  for (auto seg : d.segments()) {
+    T *p = std::find(seg.first, seg.last, value);
+    if (p != seg.last)
+      return d.begin() + int(pos + (p - seg.first));
+    pos += seg.size();
+  }
+  return d.end();
+}
+
+template <class T, class Alloc, class Policy>
+typename deque<T, Alloc, Policy>::const_iterator
+find(const deque<T, Alloc, Policy> &d, const T &value) {
+  size_t pos = 0;
+  for (auto seg : d.segments()) {
+    const T *p = std::find(seg.first, seg.last, value);
+    if (p != seg.last)
+      return d.cbegin() + int(pos + (p - seg.first));
+    pos += seg.size();
+  }
+  return d.cend();
+}
+
+/**
+ * Fold the elements into init with op, in order
+ * @return init op d[0] op d[1] op ...
+ */
+template <class T, class Alloc, class Policy, class Acc, class BinaryOp>
+Acc accumulate(const deque<T, Alloc, Policy> &d, Acc init, BinaryOp op) {
+  for (auto seg : d.segments())
+    for (const T *p = seg.first; p != seg.last; ++p)
+      init = op(std::move(init), *p);
+  return init;
+}
+
+/**
+ * Sum the elements onto init
+ * @return init + d[0] + d[1] + ...
+ */
+template <class T, class Alloc, class Policy, class Acc>
+Acc accumulate(const deque<T, Alloc, Policy> &d, Acc init) {
+  for (auto seg : d.segments())
+    for (const T *p = seg.first; p != seg.last; ++p)
+      init = std::move(init) + *p;
+  return init;
+}
+
+} // namespace sjtu
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef SJTU_DEQUE_PARALLEL_HPP
+#define SJTU_DEQUE_PARALLEL_HPP
+
+#include "deque.hpp"
+#include "work_stealing_pool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace sjtu {
+
+/**
+ * Parallel algorithms over a whole deque. The deque's contiguous segments
+ * (see deque::segments()) are collected once, and ranges of whole segments
+ * are handed to a work_stealing_pool, so every task runs plain pointer loops
+ * over elements that no other task touches. The overloads without a pool
+ * argument use work_stealing_pool::shared().
+ *
+ * The deque must not be modified while an algorithm runs, and callables are
+ * invoked concurrently from several threads.
+ */
+
+namespace parallel_detail {
+
+// Fewest elements worth handing to one task
+const size_t min_task_elements = 16384;
+
+// Segments of a deque with the global position each one starts at
+template <class Segment> struct segment_table {
+  std::vector<Segment> segments;
+  std::vector<size_t> offsets;
+  size_t grain; // Segments per task
+
+  template <class Deque> explicit segment_table(Deque &d) {
+    for (auto seg : d.segments()) {
+      offsets.push_back(segments.empty()
+                            ? 0
+                            : offsets.back() + segments.back().size());
+      segments.push_back(seg);
+    }
+    size_t n = d.size();
+    grain = n == 0 ? 1 : segments.size() * min_task_elements / n;
+    if (grain == 0)
+      grain = 1;
+  }
+
+  size_t size() const { return segments.size(); }
+};
+
+} // namespace parallel_detail
+
+/**
+ * Apply f to every element, in parallel
+ * @param pool Pool running the work
+ * @param f Callable taking T&
+ */
+template <class T, class Alloc, class Policy, class F>
+void parallel_for_each(work_stealing_pool &pool, deque<T, Alloc, Policy> &d,
+                       const F &f) {
+  typedef typename deque<T, Alloc, Policy>::segment segment;
+  parallel_detail::segment_table<segment> table(d);
+  pool.parallel_for(table.size(), table.grain, [&](size_t lo, size_t hi) {
+    for (size_t s = lo; s < hi; ++s)
+      for (T *p = table.segments[s].first; p != table.segments[s].last; ++p)
+        f(*p);
+  });
+}
+
+template <class T, class Alloc, class Policy, class F>
+void parallel_for_each(work_stealing_pool &pool,
+                       const deque<T, Alloc, Policy> &d, const F &f) {
+  typedef typename deque<T, Alloc, Policy>::const_segment segment;
+  parallel_detail::segment_table<segment> table(d);
+  pool.parallel_for(table.size(), table.grain, [&](size_t lo, size_t hi) {
+    for (size_t s = lo; s < hi; ++s)
+      for (const T *p = table.segments[s].first; p != table.segments[s].last;
+           ++p)
+        f(*p);
+  });
+}
+
+template <class T, class Alloc, class Policy, class F>
+void parallel_for_each(deque<T, Alloc, Policy> &d, const F &f) {
+  parallel_for_each(work_stealing_pool::shared(), d, f);
+}
+
+template <class T, class Alloc, class Policy, class F>
+void parallel_for_each(const deque<T, Alloc, Policy> &d, const F &f) {
+  parallel_for_each(work_stealing_pool::shared(), d, f);
+}
+
+/**
+ * Replace every element x with op(x), in parallel
+ * @param pool Pool running the work
+ * @param op Callable taking const T& and returning a value assignable to T
+ */
+template <class T, class Alloc, class Policy, class UnaryOp>
+void parallel_transform(work_stealing_pool &pool, deque<T, Alloc, Policy> &d,
+                        const UnaryOp &op) {
+  parallel_for_each(pool, d, [&](T &x) { x = op(x); });
+}
+
+template <class T, class Alloc, class Policy, class UnaryOp>
+void parallel_transform(deque<T, Alloc, Policy> &d, const UnaryOp &op) {
+  parallel_transform(work_stealing_pool::shared(), d, op);
+}
+
+/**
+ * Write op(d[i]) to out[i] for every i, in parallel
+ * @param pool Pool running the work
+ * @param out Random access iterator to storage for size() results. out + i
+ * is evaluated concurrently, which pointers and std::vector iterators allow.
+ * @param op Callable taking const T&
+ * @return out + size()
+ */
+template <class T, class Alloc, class Policy, class RandomIt, class UnaryOp>
+RandomIt parallel_transform(work_stealing_pool &pool,
+                            const deque<T, Alloc, Policy> &d, RandomIt out,
+                            const UnaryOp &op) {
+  typedef typename deque<T, Alloc, Policy>::const_segment segment;
+  parallel_detail::segment_table<segment> table(d);
+  pool.parallel_for(table.size(), table.grain, [&](size_t lo, size_t hi) {
+    for (size_t s = lo; s < hi; ++s) {
+      RandomIt dst = out + table.offsets[s];
+      for (const T *p = table.segments[s].first; p != table.segments[s].last;
+           ++p, ++dst)
+        *dst = op(*p);
+    }
+  });
+  return out + d.size();
+}
+
+template <class T, class Alloc, class Policy, class RandomIt, class UnaryOp>
+RandomIt parallel_transform(const deque<T, Alloc, Policy> &d, RandomIt out,
+                            const UnaryOp &op) {
+  return parallel_transform(work_stealing_pool::shared(), d, out, op);
+}
+
+/**
+ * Combine init and every element with op, in parallel. Each task folds its
+ * own range starting from the range's first element, and the partial results
+ * are combined onto init in element order, so op must be associative but
+ * need not be commutative.
+ * @param pool Pool running the work
+ * @param init Initial value, also the result for an empty deque
+ * @param op Callable with op(Acc, T) and op(Acc, Acc) returning Acc; Acc
+ * must be constructible from T
+ * @return init op d[0] op d[1] op ...
+ */
+template <class T, class Alloc, class Policy, class Acc, class BinaryOp>
+Acc parallel_reduce(work_stealing_pool &pool, const deque<T, Alloc, Policy> &d,
+                    Acc init, const BinaryOp &op) {
+  typedef typename deque<T, Alloc, Policy>::const_segment segment;
+  parallel_detail::segment_table<segment> table(d);
+  size_t chunks = (table.size() + table.grain - 1) / table.grain;
+  std::vector<Acc> partials(chunks, init);
+
+  // One body call per chunk of grain segments, so chunk c is fixed
+  pool.parallel_for(chunks, 1, [&](size_t c, size_t) {
+    size_t lo = c * table.grain;
+    size_t hi = std::min(lo + table.grain, table.size());
+    const T *p = table.segments[lo].first;
+    Acc acc(*p++);
+    for (size_t s = lo; s < hi; ++s) {
+      for (; p != table.segments[s].last; ++p)
+        acc = op(std::move(acc), *p);
+      if (s + 1 < hi)
+        p = table.segments[s + 1].first;
+    }
+    partials[c] = std::move(acc);
+  });
+
+  for (size_t c = 0; c < chunks; ++c)
+    init = op(std::move(init), std::move(partials[c]));
+  return init;
+}
+
+template <class T, class Alloc, class Policy, class Acc, class BinaryOp>
+Acc parallel_reduce(const deque<T, Alloc, Policy> &d, Acc init,
+                    const BinaryOp &op) {
+  return parallel_reduce(work_stealing_pool::shared(), d, std::move(init), op);
+}
+
+} // namespace sjtu
+
+#endif
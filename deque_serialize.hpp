@@ -0,0 +1,503 @@
+#ifndef SJTU_DEQUE_SERIALIZE_HPP
+#define SJTU_DEQUE_SERIALIZE_HPP
+
+#include "deque.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Util {
+class Bint;
+}
+
+namespace Diamond {
+template <typename _Td> class Matrix;
+}
+
+namespace sjtu {
+
+/**
+ * Binary format for deques, written and read one block at a time:
+ *
+ *   header   magic "SJTUDQS", u32 version, u32 flags, u32 element size,
+ *            u32 byte order mark, u64 reserved
+ *   records  u64 count, u64 bytes, then bytes of payload, one per block
+ *   end      u64 0, u64 0
+ *   table    u64 offset, u64 count for every record, offsets counted from
+ *            the start of the header
+ *   trailer  u64 records, u64 elements, u64 table offset, magic "SJTUDQE"
+ *
+ * All integers are in host byte order; a reader on a machine with the other
+ * order rejects the stream. The block table follows the records, so a
+ * writer streams without knowing its blocks in advance, and a reader can
+ * stream the records without it, or seek with block_table(). Counts and
+ * lengths read back are checked against the bytes left in a seekable
+ * stream, and payloads are read in bounded chunks, so a truncated or
+ * corrupted stream fails with runtime_error instead of exhausting memory.
+ *
+ * Elements are encoded by serializer<T>. For trivially copyable T it is
+ * raw: a record's payload is the block's bytes, written straight from the
+ * deque's storage. Other types need a specialization with
+ *   static void write(std::ostream &os, const T &value);
+ *   static T read(std::istream &is);
+ * stream_serializer<T> builds one from the stream operators.
+ */
+
+namespace serialize_detail {
+
+// Most bytes read into memory at once. Lengths come from the stream, so a
+// corrupted one must not make a reader allocate more than the stream holds.
+const std::uint64_t chunk_bytes = std::uint64_t(1) << 20;
+
+/**
+ * Bytes between the read position and the end of a seekable stream
+ * @return The largest uint64_t if the stream cannot seek
+ */
+inline std::uint64_t bytes_left(std::istream &is) {
+  std::streampos here = is.tellg();
+  if (here == std::streampos(-1))
+    return std::uint64_t(-1);
+  is.seekg(0, std::ios::end);
+  std::streampos end = is.tellg();
+  is.clear();
+  is.seekg(here);
+  if (end == std::streampos(-1))
+    return std::uint64_t(-1);
+  return end > here ? std::uint64_t(end - here) : 0;
+}
+
+/**
+ * Read exactly n bytes into out, growing it a chunk at a time
+ * @throw runtime_error if the stream ends first
+ */
+inline void read_bytes(std::istream &is, std::uint64_t n, std::string &out) {
+  out.clear();
+  while (out.size() < n) {
+    size_t old = out.size();
+    size_t piece = size_t(std::min<std::uint64_t>(chunk_bytes, n - old));
+    out.resize(old + piece);
+    is.read(&out[old], std::streamsize(piece));
+    if (!is)
+      throw runtime_error();
+  }
+}
+
+} // namespace serialize_detail
+
+// Serializer for T; specialize for types that are not trivially copyable
+template <class T, class Enable = void> struct serializer {
+  static_assert(sizeof(T) == 0, "no sjtu::serializer for this type; "
+                                "specialize sjtu::serializer<T>");
+};
+
+template <class T>
+struct serializer<
+    T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+  static const bool raw = true;
+
+  static void write(std::ostream &os, const T &value) {
+    os.write(reinterpret_cast<const char *>(std::addressof(value)), sizeof(T));
+  }
+  static T read(std::istream &is) {
+    T value;
+    is.read(reinterpret_cast<char *>(std::addressof(value)), sizeof(T));
+    return value;
+  }
+};
+
+// Length-prefixed text from operator<<. It is read back through T's
+// constructor from std::string when there is one, since that skips the
+// default construction and assignment, otherwise with operator>>.
+template <class T> struct stream_serializer {
+private:
+  static T parse(const std::string &s, std::true_type) { return T(s); }
+  static T parse(const std::string &s, std::false_type) {
+    std::istringstream text(s);
+    T value;
+    text >> value;
+    return value;
+  }
+
+public:
+  static void write(std::ostream &os, const T &value) {
+    std::ostringstream text;
+    text << value;
+    std::string s = text.str();
+    std::uint64_t n = s.size();
+    os.write(reinterpret_cast<const char *>(&n), sizeof(n));
+    os.write(s.data(), std::streamsize(n));
+  }
+  static T read(std::istream &is) {
+    std::uint64_t n = 0;
+    is.read(reinterpret_cast<char *>(&n), sizeof(n));
+    std::string s;
+    if (is)
+      serialize_detail::read_bytes(is, n, s);
+    return parse(s, std::is_constructible<T, const std::string &>());
+  }
+};
+
+template <> struct serializer<std::string> {
+  static void write(std::ostream &os, const std::string &s) {
+    std::uint64_t n = s.size();
+    os.write(reinterpret_cast<const char *>(&n), sizeof(n));
+    os.write(s.data(), std::streamsize(n));
+  }
+  static std::string read(std::istream &is) {
+    std::uint64_t n = 0;
+    is.read(reinterpret_cast<char *>(&n), sizeof(n));
+    std::string s;
+    if (is)
+      serialize_detail::read_bytes(is, n, s);
+    return s;
+  }
+};
+
+// Decimal digits through Bint's stream operators
+template <> struct serializer<Util::Bint> : stream_serializer<Util::Bint> {};
+
+// Row and column counts, then the elements row by row
+template <class Td> struct serializer<Diamond::Matrix<Td>> {
+  static void write(std::ostream &os, const Diamond::Matrix<Td> &m) {
+    std::uint64_t shape[2] = {m.RowSize(), m.ColSize()};
+    os.write(reinterpret_cast<const char *>(shape), sizeof(shape));
+    for (size_t i = 0; i < m.RowSize(); ++i)
+      for (size_t j = 0; j < m.ColSize(); ++j)
+        serializer<Td>::write(os, m[i][j]);
+  }
+  static Diamond::Matrix<Td> read(std::istream &is) {
+    std::uint64_t shape[2] = {0, 0};
+    is.read(reinterpret_cast<char *>(shape), sizeof(shape));
+    if (!is)
+      return Diamond::Matrix<Td>();
+    // Every element takes at least one byte; rows with no columns take
+    // none, so their number is capped instead
+    std::uint64_t left = serialize_detail::bytes_left(is);
+    if (shape[1] == 0 ? shape[0] > serialize_detail::chunk_bytes
+                      : shape[0] > left / shape[1])
+      throw runtime_error();
+    Diamond::Matrix<Td> m(static_cast<size_t>(shape[0]),
+                          static_cast<size_t>(shape[1]));
+    for (size_t i = 0; i < m.RowSize(); ++i)
+      for (size_t j = 0; j < m.ColSize(); ++j)
+        m[i][j] = serializer<Td>::read(is);
+    return m;
+  }
+};
+
+namespace serialize_detail {
+
+const char header_magic[8] = "SJTUDQS";
+const char trailer_magic[8] = "SJTUDQE";
+const std::uint32_t version = 1;
+const std::uint32_t raw_flag = 1;
+const std::uint32_t byte_order_mark = 0x01020304;
+
+// Whether S::raw exists and is true
+template <class S, class = void> struct is_raw : std::false_type {};
+template <class S>
+struct is_raw<S, typename std::enable_if<S::raw>::type> : std::true_type {};
+
+inline void put(std::ostream &os, std::uint64_t v) {
+  os.write(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+inline std::uint64_t get(std::istream &is) {
+  std::uint64_t v = 0;
+  is.read(reinterpret_cast<char *>(&v), sizeof(v));
+  if (!is)
+    throw runtime_error();
+  return v;
+}
+
+} // namespace serialize_detail
+
+// Position and size of one record, from the block table
+struct serialized_block {
+  std::uint64_t offset;
+  std::uint64_t count;
+};
+
+/**
+ * Writes the format to a stream, one record per write_block call
+ */
+template <class T, class S = serializer<T>> class deque_writer {
+private:
+  std::ostream &os;
+  std::uint64_t written; // Bytes since the header started
+  std::uint64_t elements;
+  std::vector<serialized_block> table;
+  bool finished;
+
+  void put(std::uint64_t v) {
+    serialize_detail::put(os, v);
+    written += sizeof(v);
+  }
+
+  void check() {
+    if (!os)
+      throw runtime_error();
+  }
+
+public:
+  /**
+   * Write the header
+   * @throw runtime_error if the stream fails
+   */
+  explicit deque_writer(std::ostream &out)
+      : os(out), written(0), elements(0), finished(false) {
+    namespace detail = serialize_detail;
+    std::uint32_t fields[4] = {
+        detail::version, detail::is_raw<S>::value ? detail::raw_flag : 0,
+        std::uint32_t(sizeof(T)), detail::byte_order_mark};
+    os.write(detail::header_magic, sizeof(detail::header_magic));
+    os.write(reinterpret_cast<const char *>(fields), sizeof(fields));
+    written = sizeof(detail::header_magic) + sizeof(fields);
+    put(0);
+    check();
+  }
+
+  deque_writer(const deque_writer &) = delete;
+  deque_writer &operator=(const deque_writer &) = delete;
+
+  /**
+   * Write n contiguous elements as one record. Raw types go out in a single
+   * write from first; others are encoded into a buffer of one block first.
+   * @throw runtime_error if the stream fails or finish() was called
+   */
+  void write_block(const T *first, size_t n) {
+    if (finished)
+      throw runtime_error();
+    if (n == 0)
+      return;
+    table.push_back(serialized_block{written, n});
+    elements += n;
+    put(n);
+    if (serialize_detail::is_raw<S>::value) {
+      put(n * sizeof(T));
+      os.write(reinterpret_cast<const char *>(first),
+               std::streamsize(n * sizeof(T)));
+      written += n * sizeof(T);
+    } else {
+      std::ostringstream payload;
+      for (size_t i = 0; i < n; ++i)
+        S::write(payload, first[i]);
+      std::string bytes = payload.str();
+      put(bytes.size());
+      os.write(bytes.data(), std::streamsize(bytes.size()));
+      written += bytes.size();
+    }
+    check();
+  }
+
+  /**
+   * Write the end record, the block table and the trailer. Without it the
+   * stream cannot be read back.
+   * @throw runtime_error if the stream fails
+   */
+  void finish() {
+    if (finished)
+      return;
+    finished = true;
+    put(0);
+    put(0);
+    std::uint64_t table_offset = written;
+    for (const serialized_block &b : table) {
+      put(b.offset);
+      put(b.count);
+    }
+    put(table.size());
+    put(elements);
+    put(table_offset);
+    os.write(serialize_detail::trailer_magic,
+             sizeof(serialize_detail::trailer_magic));
+    os.flush();
+    check();
+  }
+};
+
+/**
+ * Reads the format from a stream, one record per read_block call
+ */
+template <class T, class S = serializer<T>> class deque_reader {
+private:
+  std::istream &is;
+  std::uint64_t blocks;
+  std::uint64_t elements;
+  bool finished;
+
+  // Check the table and trailer against what was read
+  void read_tail() {
+    for (std::uint64_t b = 0; b < blocks; ++b) {
+      serialize_detail::get(is);
+      serialize_detail::get(is);
+    }
+    std::uint64_t count = serialize_detail::get(is);
+    std::uint64_t total = serialize_detail::get(is);
+    serialize_detail::get(is);
+    char magic[8];
+    is.read(magic, sizeof(magic));
+    if (!is || count != blocks || total != elements ||
+        std::memcmp(magic, serialize_detail::trailer_magic, sizeof(magic)) !=
+            0)
+      throw runtime_error();
+  }
+
+public:
+  /**
+   * Read and check the header
+   * @throw runtime_error if the stream does not hold this format for T and S
+   */
+  explicit deque_reader(std::istream &in)
+      : is(in), blocks(0), elements(0), finished(false) {
+    namespace detail = serialize_detail;
+    char magic[8];
+    std::uint32_t fields[4];
+    is.read(magic, sizeof(magic));
+    is.read(reinterpret_cast<char *>(fields), sizeof(fields));
+    detail::get(is);
+    bool raw = detail::is_raw<S>::value;
+    if (!is || std::memcmp(magic, detail::header_magic, sizeof(magic)) != 0 ||
+        fields[0] != detail::version ||
+        fields[1] != (raw ? detail::raw_flag : 0) ||
+        (raw && fields[2] != sizeof(T)) ||
+        fields[3] != detail::byte_order_mark)
+      throw runtime_error();
+  }
+
+  deque_reader(const deque_reader &) = delete;
+  deque_reader &operator=(const deque_reader &) = delete;
+
+  /**
+   * Append the next record's elements to out
+   * @return Number of elements appended, 0 once the end record is reached
+   * @throw runtime_error if the stream is truncated or malformed; the
+   * elements of the bad record are not appended
+   */
+  template <class Alloc, class Policy>
+  size_t read_block(deque<T, Alloc, Policy> &out) {
+    if (finished)
+      return 0;
+    std::uint64_t n = serialize_detail::get(is);
+    std::uint64_t bytes = serialize_detail::get(is);
+    if (n == 0) {
+      if (bytes != 0)
+        throw runtime_error();
+      finished = true;
+      read_tail();
+      return 0;
+    }
+    if (bytes > serialize_detail::bytes_left(is))
+      throw runtime_error();
+    deque<T, Alloc, Policy> decoded(out.get_allocator());
+    if (serialize_detail::is_raw<S>::value) {
+      if (bytes / sizeof(T) != n || bytes % sizeof(T) != 0)
+        throw runtime_error();
+      // Stage a bounded number of elements at a time
+      size_t per_chunk = serialize_detail::chunk_bytes / sizeof(T);
+      if (per_chunk == 0)
+        per_chunk = 1;
+      size_t staged = size_t(std::min<std::uint64_t>(n, per_chunk));
+      std::allocator<T> a;
+      T *staging = a.allocate(staged);
+      try {
+        for (std::uint64_t done = 0; done < n;) {
+          size_t k = size_t(std::min<std::uint64_t>(n - done, staged));
+          is.read(reinterpret_cast<char *>(staging),
+                  std::streamsize(k * sizeof(T)));
+          if (!is)
+            throw runtime_error();
+          decoded.append_range(staging, staging + k);
+          done += k;
+        }
+      } catch (...) {
+        a.deallocate(staging, staged);
+        throw;
+      }
+      a.deallocate(staging, staged);
+    } else {
+      std::string payload;
+      serialize_detail::read_bytes(is, bytes, payload);
+      std::istringstream record(payload);
+      for (std::uint64_t i = 0; i < n; ++i) {
+        decoded.push_back(S::read(record));
+        if (!record)
+          throw runtime_error();
+      }
+      if (record.tellg() != std::streampos(bytes))
+        throw runtime_error();
+    }
+    out.append(std::move(decoded));
+    ++blocks;
+    elements += n;
+    return size_t(n);
+  }
+
+  /**
+   * Block table of a seekable stream positioned at the header of this
+   * format, which must run to the end of the stream. Offsets are relative
+   * to the header. The stream position is restored afterwards.
+   * @throw runtime_error if the trailer or table cannot be read
+   */
+  static std::vector<serialized_block> block_table(std::istream &in) {
+    std::streampos start = in.tellg();
+    in.seekg(-std::streamoff(3 * sizeof(std::uint64_t) + 8), std::ios::end);
+    std::uint64_t count = serialize_detail::get(in);
+    serialize_detail::get(in);
+    std::uint64_t table_offset = serialize_detail::get(in);
+    char magic[8];
+    in.read(magic, sizeof(magic));
+    if (!in ||
+        std::memcmp(magic, serialize_detail::trailer_magic, sizeof(magic)) != 0)
+      throw runtime_error();
+    in.seekg(start + std::streamoff(table_offset));
+    std::vector<serialized_block> table;
+    for (std::uint64_t b = 0; b < count; ++b) {
+      std::uint64_t offset = serialize_detail::get(in);
+      std::uint64_t n = serialize_detail::get(in);
+      table.push_back(serialized_block{offset, n});
+    }
+    in.seekg(start);
+    return table;
+  }
+};
+
+/**
+ * Write d to os, one record per contiguous segment
+ * @throw runtime_error if the stream fails
+ */
+template <class T, class Alloc, class Policy>
+void save(std::ostream &os, const deque<T, Alloc, Policy> &d) {
+  deque_writer<T> writer(os);
+  for (auto seg : d.segments())
+    writer.write_block(seg.begin(), seg.size());
+  writer.finish();
+}
+
+/**
+ * Replace the contents of d with a deque read from is. d is unchanged if
+ * reading fails.
+ * @throw runtime_error if the stream is truncated or malformed
+ */
+template <class T, class Alloc, class Policy>
+void load(std::istream &is, deque<T, Alloc, Policy> &d) {
+  deque_reader<T> reader(is);
+  deque<T, Alloc, Policy> loaded(d.get_allocator());
+  while (reader.read_block(loaded) != 0) {
+  }
+  d = std::move(loaded);
+}
+
+} // namespace sjtu
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef SJTU_DEQUE_SORT_HPP
+#define SJTU_DEQUE_SORT_HPP
+
+#include "deque.hpp"
+#include "deque_parallel.hpp"
+#include "work_stealing_pool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace sjtu {
+
+/**
+ * Parallel sort for deque, in four phases:
+ *
+ * 1. The elements are moved out of the deque's segments into a contiguous
+ *    buffer, segments in parallel, and the deque is cleared.
+ * 2. The buffer is cut into one chunk per pool thread and every chunk is
+ *    sorted in place, chunks in parallel.
+ * 3. Splitters sampled evenly from the sorted chunks cut every chunk into
+ *    parts, and part p of all chunks is merged through a loser tree into its
+ *    own range of a second buffer, parts in parallel.
+ * 4. The deque is rebuilt from the merged buffer in freshly sized blocks.
+ *
+ * Blocks only hold about sqrt(n) elements, so merging them directly would
+ * pull from thousands of runs scattered over the whole deque at once; the
+ * chunks keep the merge fan-in at the thread count.
+ *
+ * The stable variant sorts chunks stably, breaks merge ties by chunk order
+ * and cuts every chunk at the same lower bound, so equal elements keep their
+ * relative order. Both need 2n elements of scratch space at most. If the
+ * comparator or a move throws, the deque stays valid but its contents are
+ * unspecified.
+ */
+
+namespace sort_detail {
+
+// Raw storage for n elements, filled range by range. The destructor
+// destroys whatever was constructed and frees the storage.
+template <class T, class Alloc> class scratch {
+private:
+  typedef std::allocator_traits<Alloc> traits;
+  Alloc alloc;
+  size_t capacity;
+
+public:
+  T *data;
+  std::vector<size_t> start; // Where each range begins
+  std::vector<size_t> built; // Elements constructed at the front of each range
+
+  scratch(const Alloc &a, size_t n, const std::vector<size_t> &starts)
+      : alloc(a), capacity(n), data(std::addressof(*traits::allocate(alloc, n))),
+        start(starts), built(starts.size(), 0) {}
+
+  scratch(const scratch &) = delete;
+  scratch &operator=(const scratch &) = delete;
+
+  ~scratch() {
+    for (size_t r = 0; r < start.size(); ++r)
+      for (size_t i = 0; i < built[r]; ++i)
+        traits::destroy(alloc, data + start[r] + i);
+    traits::deallocate(alloc, data, capacity);
+  }
+
+  // Move-construct value at the end of range r
+  void append(size_t r, Alloc &a, T &value) {
+    traits::construct(a, data + start[r] + built[r], std::move(value));
+    ++built[r];
+  }
+};
+
+// Unmerged rest [cur, end) of one sorted chunk
+template <class T> struct cursor {
+  T *cur;
+  T *end;
+};
+
+/**
+ * Loser tree over k sorted runs, each internal node holding the run that
+ * lost the match played there. Taking the next element costs one
+ * comparison per level. Runs are numbered in chunk order and ties go to
+ * the lower number, which keeps the merge stable.
+ */
+template <class T, class Compare> class loser_tree {
+private:
+  cursor<T> *runs;
+  size_t leaves;             // k rounded up to a power of two
+  std::vector<size_t> loser; // loser[0] holds the overall winner
+  Compare &comp;
+
+  // Whether run a's head goes before run b's; padding and exhausted runs
+  // lose every match
+  bool beats(size_t a, size_t b) const {
+    if (b >= leaves || runs[b].cur == runs[b].end)
+      return true;
+    if (runs[a].cur == runs[a].end)
+      return false;
+    return a < b ? !comp(*runs[b].cur, *runs[a].cur)
+                 : comp(*runs[a].cur, *runs[b].cur);
+  }
+
+public:
+  loser_tree(cursor<T> *r, size_t k, Compare &c)
+      : runs(r), leaves(1), comp(c) {
+    while (leaves < k)
+      leaves *= 2;
+    loser.assign(leaves, 0);
+    std::vector<size_t> winner(2 * leaves);
+    for (size_t i = 0; i < leaves; ++i)
+      winner[leaves + i] = i < k ? i : leaves; // leaves marks padding
+    for (size_t node = leaves - 1; node > 0; --node) {
+      size_t a = winner[2 * node], b = winner[2 * node + 1];
+      bool a_wins = a < leaves && beats(a, b);
+      winner[node] = a_wins ? a : b;
+      loser[node] = a_wins ? b : a;
+    }
+    loser[0] = winner[1];
+  }
+
+  // Run holding the next element, or none if all are exhausted
+  bool empty() const {
+    return loser[0] >= leaves || runs[loser[0]].cur == runs[loser[0]].end;
+  }
+  cursor<T> &top() { return runs[loser[0]]; }
+
+  // Replay the matches on the path of the winner after it advanced
+  void replay() {
+    size_t w = loser[0];
+    for (size_t node = (w + leaves) / 2; node > 0; node /= 2) {
+      if (loser[node] < leaves && !beats(w, loser[node]))
+        std::swap(w, loser[node]);
+    }
+    loser[0] = w;
+  }
+};
+
+/**
+ * Merge k sorted runs by moving their elements to the end of range r of out
+ */
+template <class T, class Alloc, class Compare>
+void merge_runs(cursor<T> *runs, size_t k, scratch<T, Alloc> &out, size_t r,
+                Alloc &alloc, Compare &comp) {
+  if (k == 0)
+    return;
+  loser_tree<T, Compare> tree(runs, k, comp);
+  while (!tree.empty()) {
+    cursor<T> &c = tree.top();
+    out.append(r, alloc, *c.cur);
+    ++c.cur;
+    tree.replay();
+  }
+}
+
+template <class T, class Alloc, class Policy, class Compare>
+void sort(work_stealing_pool &pool, deque<T, Alloc, Policy> &d,
+          const Compare &comp, bool stable) {
+  typedef typename deque<T, Alloc, Policy>::segment segment;
+
+  size_t n = d.size();
+  if (n < 2)
+    return;
+  Alloc alloc = d.get_allocator();
+
+  // Phase 1: move every segment to its place in a contiguous buffer
+  parallel_detail::segment_table<segment> table(d);
+  scratch<T, Alloc> in(alloc, n, table.offsets);
+  pool.parallel_for(table.size(), table.grain, [&](size_t lo, size_t hi) {
+    Alloc a(alloc);
+    for (size_t s = lo; s < hi; ++s)
+      for (T *p = table.segments[s].first; p != table.segments[s].last; ++p)
+        in.append(s, a, *p);
+  });
+  d.clear();
+
+  // Phase 2: sort one chunk per thread in place
+  size_t chunks = std::min(pool.size(),
+                           (n + parallel_detail::min_task_elements - 1) /
+                               parallel_detail::min_task_elements);
+  if (chunks == 0)
+    chunks = 1;
+  std::vector<T *> bound(chunks + 1);
+  for (size_t c = 0; c <= chunks; ++c)
+    bound[c] = in.data + c * n / chunks;
+  pool.parallel_for(chunks, 1, [&](size_t c, size_t) {
+    Compare cmp(comp);
+    if (stable)
+      std::stable_sort(bound[c], bound[c + 1], cmp);
+    else
+      std::sort(bound[c], bound[c + 1], cmp);
+  });
+  if (chunks == 1) {
+    d.append_range(std::make_move_iterator(in.data),
+                   std::make_move_iterator(in.data + n));
+    return;
+  }
+
+  // Phase 3a: pick parts - 1 splitters from samples taken evenly across
+  // every sorted chunk
+  size_t parts = std::min(pool.size() * 4,
+                          (n + parallel_detail::min_task_elements - 1) /
+                              parallel_detail::min_task_elements);
+  std::vector<const T *> splitters;
+  {
+    size_t per_chunk = std::max(size_t(1), parts * 32 / chunks);
+    std::vector<const T *> samples;
+    for (size_t c = 0; c < chunks; ++c) {
+      size_t len = bound[c + 1] - bound[c];
+      for (size_t i = 1; i <= per_chunk; ++i)
+        samples.push_back(bound[c] + i * len / (per_chunk + 1));
+    }
+    std::sort(samples.begin(), samples.end(),
+              [&](const T *a, const T *b) { return comp(*a, *b); });
+    for (size_t p = 1; p < parts; ++p)
+      splitters.push_back(samples[p * samples.size() / parts]);
+  }
+
+  // Phase 3b: cut[p * chunks + c] is where part p starts in chunk c; every
+  // chunk is cut at the lower bound of the same splitter
+  std::vector<T *> cut((parts + 1) * chunks);
+  for (size_t c = 0; c < chunks; ++c) {
+    cut[c] = bound[c];
+    cut[parts * chunks + c] = bound[c + 1];
+  }
+  for (size_t p = 1; p < parts; ++p)
+    for (size_t c = 0; c < chunks; ++c)
+      cut[p * chunks + c] =
+          std::lower_bound(bound[c], bound[c + 1], *splitters[p - 1], comp);
+  std::vector<size_t> offset(parts, 0);
+  for (size_t p = 0; p + 1 < parts; ++p) {
+    offset[p + 1] = offset[p];
+    for (size_t c = 0; c < chunks; ++c)
+      offset[p + 1] += cut[(p + 1) * chunks + c] - cut[p * chunks + c];
+  }
+
+  // Phase 3c: merge each part into its own range of a second buffer
+  scratch<T, Alloc> out(alloc, n, offset);
+  pool.parallel_for(parts, 1, [&](size_t p, size_t) {
+    Compare cmp(comp);
+    Alloc a(alloc);
+    std::vector<cursor<T>> runs;
+    for (size_t c = 0; c < chunks; ++c)
+      runs.push_back(cursor<T>{cut[p * chunks + c], cut[(p + 1) * chunks + c]});
+    merge_runs(runs.data(), runs.size(), out, p, a, cmp);
+  });
+
+  // Phase 4: repack into fresh blocks
+  d.append_range(std::make_move_iterator(out.data),
+                 std::make_move_iterator(out.data + n));
+}
+
+} // namespace sort_detail
+
+/**
+ * Sort the deque in parallel
+ * @param pool Pool running the work
+ * @param comp Strict weak ordering, invoked concurrently from several threads
+ */
+template <class T, class Alloc, class Policy, class Compare>
+void sort(work_stealing_pool &pool, deque<T, Alloc, Policy> &d,
+          Compare comp) {
+  sort_detail::sort(pool, d, comp, false);
+}
+
+template <class T, class Alloc, class Policy>
+void sort(work_stealing_pool &pool, deque<T, Alloc, Policy> &d) {
+  sort_detail::sort(pool, d, std::less<T>(), false);
+}
+
+template <class T, class Alloc, class Policy, class Compare>
+void sort(deque<T, Alloc, Policy> &d, Compare comp) {
+  sort_detail::sort(work_stealing_pool::shared(), d, comp, false);
+}
+
+template <class T, class Alloc, class Policy>
+void sort(deque<T, Alloc, Policy> &d) {
+  sort_detail::sort(work_stealing_pool::shared(), d, std::less<T>(), false);
+}
+
+/**
+ * Sort the deque in parallel, keeping equal elements in their original order
+ * @param pool Pool running the work
+ * @param comp Strict weak ordering, invoked concurrently from several threads
+ */
+template <class T, class Alloc, class Policy, class Compare>
+void stable_sort(work_stealing_pool &pool, deque<T, Alloc, Policy> &d,
+                 Compare comp) {
+  sort_detail::sort(pool, d, comp, true);
+}
+
+template <class T, class Alloc, class Policy>
+void stable_sort(work_stealing_pool &pool, deque<T, Alloc, Policy> &d) {
+  sort_detail::sort(pool, d, std::less<T>(), true);
+}
+
+template <class T, class Alloc, class Policy, class Compare>
+void stable_sort(deque<T, Alloc, Policy> &d, Compare comp) {
+  sort_detail::sort(work_stealing_pool::shared(), d, comp, true);
+}
+
+template <class T, class Alloc, class Policy>
+void stable_sort(deque<T, Alloc, Policy> &d) {
+  sort_detail::sort(work_stealing_pool::shared(), d, std::less<T>(), true);
+}
+
+} // namespace sjtu
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef SJTU_DEQUE_STATS_HPP
+#define SJTU_DEQUE_STATS_HPP
+
+#include <cstddef>
+
+namespace sjtu {
+
+/**
+ * Operation counters and structure of one deque, returned by deque::stats().
+ *
+ * The counters are only kept when SJTU_DEQUE_STATS is defined before
+ * deque.hpp is included; otherwise the hooks compile to nothing and the
+ * counters read zero. They count up from the deque's construction and are
+ * never reset, so an exporter can publish them as monotonic counters. The
+ * structural fields are measured on every stats() call either way.
+ */
+struct deque_stats {
+  // Number of fill histogram buckets, each a tenth of the maximum block size
+  static const size_t fill_buckets = 10;
+
+  bool counting = false; // Whether the counters were compiled in
+
+  // Counters
+  size_t splits = 0;
+  size_t merges = 0;
+  size_t node_allocations = 0; // Block list nodes created
+  size_t node_frees = 0;       // Block list nodes destroyed
+  size_t index_rebuilds = 0;
+  size_t index_rebuild_blocks = 0; // Blocks walked by those rebuilds
+  size_t at_calls = 0;             // at() and operator[]
+  size_t at_blocks_visited = 0;    // Index entries probed by them
+  size_t jump_calls = 0;           // Iterator + n and - n
+  size_t jump_blocks_visited = 0;  // Index entries probed by them
+
+  // Structure at the time of the call
+  size_t size = 0;
+  size_t blocks = 0;
+  size_t min_block_size = 0;  // Current merge threshold
+  size_t max_block_size = 0;  // Current split threshold
+  size_t small_blocks = 0;    // Blocks below min_block_size
+  size_t smallest_block = 0;
+  size_t largest_block = 0;
+  // fill_histogram[i] counts blocks holding between i/10 and (i+1)/10 of
+  // max_block_size elements; full blocks go to the last bucket
+  size_t fill_histogram[fill_buckets] = {};
+
+  double at_blocks_per_call() const {
+    return at_calls == 0 ? 0.0 : double(at_blocks_visited) / at_calls;
+  }
+  double jump_blocks_per_call() const {
+    return jump_calls == 0 ? 0.0 : double(jump_blocks_visited) / jump_calls;
+  }
+};
+
+/**
+ * Bytes held by one deque, returned by deque::memory_usage(). Node links
+ * count the list pointers of live blocks only; unused chunks of the node
+ * pool and allocator bookkeeping are not included.
+ */
+struct deque_memory {
+  size_t container = 0;     // sizeof the deque object itself
+  size_t payload = 0;       // Elements, size() * sizeof(T)
+  size_t slack = 0;         // Unused element slots in live blocks
+  size_t block_headers = 0; // Block records: buffer pointer, bounds, ordinal
+  size_t node_links = 0;    // Block list prev/next pointers
+  size_t index = 0;         // Block index table and Fenwick tree
+  size_t spares = 0;        // Spare block storage kept at the ends
+
+  size_t total() const {
+    return container + payload + slack + block_headers + node_links + index +
+           spares;
+  }
+  size_t overhead() const { return total() - payload; }
+};
+
+} // namespace sjtu
+
+#endif
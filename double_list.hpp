@@ -1,4 +1,8 @@
-template <class T> class double_list {
+#include "node_pool.hpp"
+#include <memory>
+#include <utility>
+
+template <class T, class Alloc = std::allocator<T>> class double_list {
 private:
   struct node {
     T val;
@@ -6,18 +10,86 @@ private:
     node *next;
     node(const T &val, node *prev = nullptr, node *next = nullptr)
         : val(val), prev(prev), next(next) {}
+    node(T &&val, node *prev = nullptr, node *next = nullptr)
+        : val(std::move(val)), prev(prev), next(next) {}
+    // 原地构造 val
+    template <class... Args>
+    node(node *prev, node *next, Args &&...args)
+        : val(std::forward<Args>(args)...), prev(prev), next(next) {}
   };
+  typedef sjtu::node_pool<Alloc> pool_type;
+
   int sizee;
+  pool_type *pool; // 节点所在的内存池，首次分配时才创建自有池
+  bool owns_pool;  // pool 是否由本链表创建并负责释放
+  Alloc alloc;     // 自有池的 slab 内存从这里分配
+#ifdef SJTU_DEQUE_STATS
+  size_t created = 0;   // 累计创建的节点数，仅在开启统计时维护
+  size_t destroyed = 0; // 累计销毁的节点数
+#endif
+
+  pool_type &get_pool() {
+    if (pool == nullptr) {
+      pool = new pool_type(sizeof(node), 8, alloc);
+      owns_pool = true;
+    }
+    return *pool;
+  }
+
+  // 从内存池取一块内存并原地构造节点
+  template <class... Args> node *create_node(Args &&...args) {
+    void *mem = get_pool().allocate();
+    try {
+      node *n = new (mem) node(std::forward<Args>(args)...);
+#ifdef SJTU_DEQUE_STATS
+      ++created;
+#endif
+      return n;
+    } catch (...) {
+      pool->deallocate(mem);
+      throw;
+    }
+  }
+
+  // 析构节点并把内存还给内存池
+  void destroy_node(node *n) {
+    n->~node();
+    pool->deallocate(n);
+#ifdef SJTU_DEQUE_STATS
+    ++destroyed;
+#endif
+  }
+
+  void release_pool() {
+    if (owns_pool)
+      delete pool;
+    pool = nullptr;
+    owns_pool = false;
+  }
 
 public:
   node *head;
   node *tail;
-  double_list() : sizee(0), head(nullptr), tail(nullptr) {}
-  double_list(int sizee, node *head, node *tail)
-      : sizee(sizee), head(head), tail(tail) {}
-  // 深拷贝的拷贝构造函数
+  explicit double_list(const Alloc &a = Alloc())
+      : sizee(0), pool(nullptr), owns_pool(false), alloc(a), head(nullptr),
+        tail(nullptr) {}
+  /**
+   * 使用外部内存池，pool 的块大小需不小于 node_bytes()，且须比链表活得久
+   */
+  explicit double_list(pool_type &shared, const Alloc &a = Alloc())
+      : sizee(0), pool(&shared), owns_pool(false), alloc(a), head(nullptr),
+        tail(nullptr) {}
+  // 使用当前线程共享的内存池，同一线程上的所有此类链表共用它
+  explicit double_list(sjtu::thread_pool_t)
+      : sizee(0), pool(&thread_pool()), owns_pool(false), head(nullptr),
+        tail(nullptr) {}
+  // 深拷贝的拷贝构造函数，共享池会沿用，自有池则另建
   double_list(const double_list &other)
-      : head(nullptr), tail(nullptr), sizee(0) {
+      : sizee(0), pool(other.owns_pool ? nullptr : other.pool),
+        owns_pool(false),
+        alloc(std::allocator_traits<Alloc>::
+                  select_on_container_copy_construction(other.alloc)),
+        head(nullptr), tail(nullptr) {
     node *current = other.head;
     while (current != nullptr) {
       insert_tail(current->val);
@@ -25,8 +97,20 @@ public:
     }
   }
 
+  // 移动构造：直接接管 other 的节点及其内存池
+  double_list(double_list &&other) noexcept
+      : sizee(other.sizee), pool(other.pool), owns_pool(other.owns_pool),
+        alloc(other.alloc), head(other.head), tail(other.tail) {
+    other.head = other.tail = nullptr;
+    other.sizee = 0;
+    if (other.owns_pool) {
+      other.pool = nullptr;
+      other.owns_pool = false;
+    }
+  }
+
   // 赋值运算符重载
-  double_list<T> &operator=(const double_list<T> &other) {
+  double_list &operator=(const double_list &other) {
     if (this == &other) {
       return *this;
     }
@@ -38,7 +122,69 @@ public:
     }
     return *this;
   }
-  ~double_list() { clear(); }
+  // 移动赋值：释放自身节点后接管 other 的节点
+  double_list &operator=(double_list &&other) noexcept {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    release_pool();
+    head = other.head;
+    tail = other.tail;
+    sizee = other.sizee;
+    pool = other.pool;
+    owns_pool = other.owns_pool;
+    alloc = other.alloc;
+    other.head = other.tail = nullptr;
+    other.sizee = 0;
+    if (other.owns_pool) {
+      other.pool = nullptr;
+      other.owns_pool = false;
+    }
+    return *this;
+  }
+  ~double_list() {
+    clear();
+    release_pool();
+  }
+
+  // 当前线程共享的内存池，线程退出时释放，使用它的链表不能活得更久
+  static pool_type &thread_pool() {
+    thread_local pool_type shared(sizeof(node), 64);
+    return shared;
+  }
+
+  Alloc get_allocator() const { return alloc; }
+
+  // 累计创建和销毁的节点数，未定义 SJTU_DEQUE_STATS 时恒为 0
+  size_t created_nodes() const {
+#ifdef SJTU_DEQUE_STATS
+    return created;
+#else
+    return 0;
+#endif
+  }
+  size_t destroyed_nodes() const {
+#ifdef SJTU_DEQUE_STATS
+    return destroyed;
+#else
+    return 0;
+#endif
+  }
+
+  // 每个节点占用的字节数，外部内存池的块大小不能小于它
+  static size_t node_bytes() { return sizeof(node); }
+
+  // 预先备好 n 个节点的内存，之后的 n 次插入不会再向分配器申请内存
+  void reserve_nodes(size_t n) { get_pool().reserve(n); }
+
+  // 两个链表的节点是否来自同一内存池，只有这时 splice 才能直接改指针
+  // 使用的外部内存池，自有池或尚未分配时为 nullptr
+  pool_type *shared_pool() const { return owns_pool ? nullptr : pool; }
+
+  bool shares_pool(const double_list &other) const {
+    return pool != nullptr && pool == other.pool;
+  }
   class iterator {
   public:
     double_list *dl;
@@ -47,12 +193,7 @@ public:
     iterator(double_list *dl = nullptr, node *ptr = nullptr)
         : dl(dl), ptr(ptr) {}
     iterator(node *node) : ptr(node) {}
-    iterator(const iterator &t) {
-      if (this == &t)
-        return;
-      dl = t.dl;
-      ptr = t.ptr;
-    }
+    iterator(const iterator &t) = default;
     ~iterator() = default;
     /**
      * iter++
@@ -269,29 +410,50 @@ public:
       tail = node_to_delete->prev;
     }
 
-    delete node_to_delete;
+    destroy_node(node_to_delete);
     node_to_delete = nullptr;
     sizee--;
 
     return iterator(this, next_node);
   }
-  iterator insert(iterator pos, const T &val) {
+  // 删除 [first, last) 内的所有节点：整段一次摘下后再逐个析构，返回 last
+  iterator erase(iterator first, iterator last) {
+    if (first.dl != this || last.dl != this || first.ptr == last.ptr)
+      return last;
+    node *before = first.ptr->prev;
+    node *after = last.ptr;
+    if (before)
+      before->next = after;
+    else
+      head = after;
+    if (after)
+      after->prev = before;
+    else
+      tail = before;
+
+    node *current = first.ptr;
+    while (current != after) {
+      node *next = current->next;
+      destroy_node(current);
+      sizee--;
+      current = next;
+    }
+    return last;
+  }
+  iterator insert(iterator pos, const T &val) { return emplace(pos, val); }
+  iterator insert(iterator pos, T &&val) { return emplace(pos, std::move(val)); }
+
+  template <class... Args> iterator emplace(iterator pos, Args &&...args) {
     if (pos.dl != this)
       throw "invalid";
 
     if (pos.ptr == nullptr) {
-      if (tail == nullptr) {
-        insert_tail(val);
-        return iterator(this, tail);
-      }
-      node *new_node = new node(val, tail, nullptr);
-      tail->next = new_node;
-      tail = new_node;
-      sizee++;
-      return iterator(this, new_node);
+      emplace_tail(std::forward<Args>(args)...);
+      return iterator(this, tail);
     }
 
-    node *new_node = new node(val, pos.ptr->prev, pos.ptr);
+    node *new_node =
+        create_node(pos.ptr->prev, pos.ptr, std::forward<Args>(args)...);
     if (pos.ptr->prev)
       pos.ptr->prev->next = new_node;
     else
@@ -310,8 +472,13 @@ public:
   /**
    * the following are operations of double list
    */
-  void insert_head(const T &val) {
-    node *new_node = new node(val, nullptr, head);
+  void insert_head(const T &val) { emplace_head(val); }
+  void insert_head(T &&val) { emplace_head(std::move(val)); }
+  void insert_tail(const T &val) { emplace_tail(val); }
+  void insert_tail(T &&val) { emplace_tail(std::move(val)); }
+
+  template <class... Args> void emplace_head(Args &&...args) {
+    node *new_node = create_node(nullptr, head, std::forward<Args>(args)...);
     if (head != nullptr)
       head->prev = new_node;
     head = new_node;
@@ -319,8 +486,8 @@ public:
       tail = head;
     sizee++;
   }
-  void insert_tail(const T &val) {
-    node *new_node = new node(val, tail, nullptr);
+  template <class... Args> void emplace_tail(Args &&...args) {
+    node *new_node = create_node(tail, nullptr, std::forward<Args>(args)...);
     if (tail != nullptr)
       tail->next = new_node;
     tail = new_node;
@@ -335,7 +502,7 @@ public:
     head = head->next;
     if (head != nullptr)
       head->prev = nullptr;
-    delete temp;
+    destroy_node(temp);
     temp = nullptr;
     sizee--;
   }
@@ -346,7 +513,7 @@ public:
     tail = tail->prev;
     if (tail != nullptr)
       tail->next = nullptr;
-    delete temp;
+    destroy_node(temp);
     temp = nullptr;
     sizee--;
   }
@@ -360,7 +527,7 @@ public:
     while (current != nullptr) {
       node *temp = current;
       current = current->next;
-      delete temp;
+      destroy_node(temp);
       temp = nullptr;
     }
     head = tail = nullptr;
@@ -370,6 +537,10 @@ public:
   void splice(double_list &other) {
     if (other.empty())
       return;
+    if (!shares_pool(other)) {
+      splice(end(), other, other.begin(), other.end());
+      return;
+    }
 
     if (empty()) {
       head = other.head;
@@ -389,6 +560,12 @@ public:
   void splice(iterator pos, double_list &other, iterator it) {
     if (pos.dl != this || it.dl != &other || it.ptr == nullptr)
       return;
+    if (!shares_pool(other)) {
+      // 节点属于另一个内存池，只能移动元素后在原池中释放节点
+      emplace(pos, std::move(it.ptr->val));
+      other.erase(it);
+      return;
+    }
 
     node *n = it.ptr;
 
@@ -433,6 +610,13 @@ public:
 
     if (!start || !end)
       return;
+    if (!shares_pool(other)) {
+      while (first != last) {
+        emplace(pos, std::move(first.ptr->val));
+        first = other.erase(first);
+      }
+      return;
+    }
 
     if (start->prev)
       start->prev->next = last.ptr;
@@ -478,7 +662,7 @@ public:
       tail->next = nullptr;
     else
       head = nullptr;
-    delete temp;
+    destroy_node(temp);
     temp = nullptr;
     sizee--;
   }
@@ -492,7 +676,7 @@ public:
       head->prev = nullptr;
     else
       tail = nullptr;
-    delete temp;
+    destroy_node(temp);
     temp = nullptr;
     sizee--;
   }
@@ -0,0 +1,140 @@
+#ifndef SJTU_NODE_POOL_HPP
+#define SJTU_NODE_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace sjtu {
+
+/**
+ * Slab allocator for fixed-size chunks, used for linked list nodes.
+ * Chunks are carved out of slabs that double in size up to a cap, and freed
+ * chunks go onto an intrusive free list for reuse, so steady insert/erase
+ * churn never reaches the global allocator. All slabs are released when the
+ * pool is destroyed; every chunk must have been returned (or its object
+ * destroyed) by then. Slab memory comes from Alloc, rebound to
+ * std::max_align_t so chunks stay suitably aligned.
+ */
+template <class Alloc = std::allocator<char>> class node_pool {
+private:
+  typedef typename std::allocator_traits<Alloc>::template rebind_alloc<
+      std::max_align_t>
+      slab_allocator;
+  typedef std::allocator_traits<slab_allocator> slab_traits;
+
+  struct slab {
+    slab *next;
+    size_t units;
+  };
+  struct free_chunk {
+    free_chunk *next;
+  };
+
+  static const size_t align = alignof(std::max_align_t);
+  static const size_t max_slab_chunks = 1024;
+
+  size_t chunk_size;       // Bytes per chunk, rounded up to align
+  size_t next_slab_chunks; // Number of chunks in the next slab
+  slab *slabs;             // All slabs owned by this pool
+  free_chunk *free_list;   // Chunks ready for reuse
+  size_t free_chunks;      // Length of free_list
+  slab_allocator alloc;    // Source of slab memory
+
+  static size_t round_up(size_t n) { return (n + align - 1) / align * align; }
+
+  // Header bytes in front of the chunks of a slab
+  static size_t header_size() { return round_up(sizeof(slab)); }
+
+  // Number of max_align_t units in a slab holding n chunks, stored in its
+  // header so the slab can be returned to the allocator with the same size
+  size_t slab_units(size_t n) const {
+    return (header_size() + chunk_size * n) / align;
+  }
+
+  // Allocate a slab of n chunks and thread them onto the free list
+  void add_slab(size_t n) {
+    size_t units = slab_units(n);
+    char *raw = reinterpret_cast<char *>(
+        std::addressof(*slab_traits::allocate(alloc, units)));
+    slab *s = reinterpret_cast<slab *>(raw);
+    s->next = slabs;
+    s->units = units;
+    slabs = s;
+    char *chunk = raw + header_size();
+    for (size_t i = 0; i < n; ++i, chunk += chunk_size) {
+      free_chunk *f = reinterpret_cast<free_chunk *>(chunk);
+      f->next = free_list;
+      free_list = f;
+    }
+    free_chunks += n;
+  }
+
+public:
+  /**
+   * @param size Size in bytes of every chunk handed out
+   * @param first_slab_chunks Number of chunks in the first slab
+   * @param a Allocator providing slab memory
+   */
+  explicit node_pool(size_t size, size_t first_slab_chunks = 8,
+                     const Alloc &a = Alloc())
+      : chunk_size(round_up(size < sizeof(free_chunk) ? sizeof(free_chunk)
+                                                      : size)),
+        next_slab_chunks(first_slab_chunks == 0 ? 1 : first_slab_chunks),
+        slabs(nullptr), free_list(nullptr), free_chunks(0), alloc(a) {}
+
+  node_pool(const node_pool &) = delete;
+  node_pool &operator=(const node_pool &) = delete;
+
+  ~node_pool() {
+    while (slabs != nullptr) {
+      slab *s = slabs;
+      slabs = s->next;
+      slab_traits::deallocate(alloc, reinterpret_cast<std::max_align_t *>(s),
+                              s->units);
+    }
+  }
+
+  // Size in bytes of the chunks this pool hands out
+  size_t chunk_bytes() const { return chunk_size; }
+
+  /**
+   * Make sure the next n calls to allocate() do not allocate a slab
+   * @param n Number of chunks to have ready
+   */
+  void reserve(size_t n) {
+    if (free_chunks < n)
+      add_slab(n - free_chunks);
+  }
+
+  // Get an uninitialized chunk
+  void *allocate() {
+    if (free_list == nullptr) {
+      add_slab(next_slab_chunks);
+      if (next_slab_chunks < max_slab_chunks)
+        next_slab_chunks *= 2;
+    }
+    free_chunk *f = free_list;
+    free_list = f->next;
+    --free_chunks;
+    return f;
+  }
+
+  // Return a chunk obtained from allocate()
+  void deallocate(void *p) {
+    free_chunk *f = static_cast<free_chunk *>(p);
+    f->next = free_list;
+    free_list = f;
+    ++free_chunks;
+  }
+};
+
+// Tag selecting the calling thread's shared node pool
+struct thread_pool_t {
+  explicit thread_pool_t() {}
+};
+static const thread_pool_t thread_pool = thread_pool_t();
+
+} // namespace sjtu
+
+#endif
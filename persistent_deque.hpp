@@ -0,0 +1,488 @@
+#ifndef SJTU_PERSISTENT_DEQUE_HPP
+#define SJTU_PERSISTENT_DEQUE_HPP
+
+#include "exceptions.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sjtu {
+
+/**
+ * Deque of trivially copyable records whose blocks live in a memory-mapped
+ * file (POSIX only).
+ *
+ * File layout, all offsets in bytes from the start of the file:
+ * - page 0: header (format, record size, block geometry, table position)
+ * - block table: a ring of {offset, first, count} entries, one per block,
+ *   in deque order
+ * - block slots: block_bytes each, page aligned; freed slots are chained
+ *   through their first 8 bytes into a free list
+ *
+ * Every block except the first and the last is full, so operator[] finds
+ * its block by division in O(1). Opening an existing file maps it and
+ * checks the header and every block table entry against the file size, so
+ * a truncated or corrupt file is rejected instead of read out of bounds.
+ * Nothing is deserialized: startup is O(blocks), independent of the number
+ * of elements.
+ *
+ * With durability::synchronous every push and pop msyncs what it wrote
+ * before returning. A record is written and synced before the table entry
+ * or header field that makes it visible. Otherwise the kernel writes pages
+ * back on its own schedule, and sync() flushes everything.
+ *
+ * Only the ends can be modified. Any mutation can remap the file, so
+ * references returned by operator[], front() and back() are invalidated by
+ * the next push, pop or clear.
+ */
+template <class T> class persistent_deque {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "persistent_deque needs a trivially copyable T");
+
+public:
+  enum class durability {
+    deferred,   // Written back by the kernel, or by sync()
+    synchronous // msync after every push and pop
+  };
+
+private:
+  struct header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t element_size;
+    std::uint64_t block_capacity; // Records per block
+    std::uint64_t block_bytes;    // Bytes per block slot, page aligned
+    std::uint64_t used;           // End of the allocated part of the file
+    std::uint64_t free_head;      // First free block slot, 0 if none
+    std::uint64_t table_offset;
+    std::uint64_t table_capacity; // Entries
+    std::uint64_t table_head;     // Ring position of the first block
+    std::uint64_t table_count;    // Blocks in the deque
+  };
+
+  struct entry {
+    std::uint64_t offset; // Block slot
+    std::uint32_t first;  // Ring position of the block's first record
+    std::uint32_t count;  // Records in the block
+  };
+
+  static const std::uint32_t format_version = 1;
+
+  int fd;
+  char *base;         // Mapping of the whole file
+  size_t mapped;      // Bytes mapped, equal to the file size
+  size_t page;
+  durability mode;
+
+  header &head() const { return *reinterpret_cast<header *>(base); }
+  entry &block_at(size_t b) const {
+    header &h = head();
+    entry *table = reinterpret_cast<entry *>(base + h.table_offset);
+    return table[(h.table_head + b) % h.table_capacity];
+  }
+  T *record(const entry &e, size_t i) const {
+    return reinterpret_cast<T *>(base + e.offset) +
+           (e.first + i) % head().block_capacity;
+  }
+
+  static bool same_magic(const char *m) {
+    return std::memcmp(m, "SJTUPDQ", 8) == 0;
+  }
+
+  size_t round_to_page(size_t n) const { return (n + page - 1) / page * page; }
+
+  void map(size_t bytes) {
+    void *p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+      throw runtime_error();
+    base = static_cast<char *>(p);
+    mapped = bytes;
+  }
+
+  // Make the file at least end bytes long, doubling it to keep remaps rare
+  void ensure(size_t end) {
+    if (end <= mapped)
+      return;
+    size_t bytes = mapped * 2;
+    if (bytes < end)
+      bytes = round_to_page(end);
+    if (::ftruncate(fd, off_t(bytes)) != 0)
+      throw runtime_error();
+    ::munmap(base, mapped);
+    base = nullptr;
+    map(bytes);
+  }
+
+  // Carve n bytes off the end of the allocated part of the file
+  std::uint64_t carve(size_t n) {
+    std::uint64_t offset = head().used;
+    ensure(offset + n);
+    head().used = offset + n;
+    return offset;
+  }
+
+  // The free list head is synced before a reused slot is overwritten, and a
+  // freed slot's link before it joins the list, so a crash can leak a slot
+  // but never corrupt the list
+  std::uint64_t take_slot() {
+    header &h = head();
+    if (h.free_head != 0) {
+      std::uint64_t slot = h.free_head;
+      std::memcpy(&h.free_head, base + slot, sizeof(std::uint64_t));
+      flush_header();
+      return slot;
+    }
+    return carve(h.block_bytes);
+  }
+
+  void free_slot(std::uint64_t slot) {
+    std::memcpy(base + slot, &head().free_head, sizeof(std::uint64_t));
+    flush(base + slot, sizeof(std::uint64_t));
+    head().free_head = slot;
+    flush_header();
+  }
+
+  // Move the table to a fresh region twice as large, blocks starting at 0.
+  // The old region is not reused.
+  void grow_table() {
+    size_t capacity = head().table_capacity * 2;
+    std::uint64_t offset = carve(round_to_page(capacity * sizeof(entry)));
+    header &h = head();
+    entry *fresh = reinterpret_cast<entry *>(base + offset);
+    for (size_t b = 0; b < h.table_count; ++b)
+      fresh[b] = block_at(b);
+    flush(fresh, h.table_count * sizeof(entry));
+    h.table_offset = offset;
+    h.table_capacity = capacity;
+    h.table_head = 0;
+  }
+
+  // In synchronous mode, write [p, p + n) back and wait for it; a failed
+  // msync throws, so nothing reports success without being durable
+  void flush(const void *p, size_t n) {
+    if (mode != durability::synchronous || n == 0)
+      return;
+    size_t from = size_t(static_cast<const char *>(p) - base) / page * page;
+    if (::msync(base + from,
+                size_t(static_cast<const char *>(p) - base) + n - from,
+                MS_SYNC) != 0)
+      throw runtime_error();
+  }
+
+  void flush_header() { flush(base, sizeof(header)); }
+
+  void create(size_t block_bytes) {
+    size_t slot_bytes = round_to_page(block_bytes < sizeof(T) ? sizeof(T)
+                                                              : block_bytes);
+    size_t table_bytes = page;
+    ensure(page + table_bytes);
+    header &h = head();
+    std::memset(&h, 0, sizeof(header));
+    h.version = format_version;
+    h.element_size = sizeof(T);
+    h.block_capacity = slot_bytes / sizeof(T);
+    h.block_bytes = slot_bytes;
+    h.used = page + table_bytes;
+    h.free_head = 0;
+    h.table_offset = page;
+    h.table_capacity = table_bytes / sizeof(entry);
+    h.table_head = 0;
+    h.table_count = 0;
+    // The magic goes last, so a half-created file is never taken as valid
+    flush_header();
+    std::memcpy(h.magic, "SJTUPDQ", 8);
+    flush_header();
+  }
+
+  // Whether the header and block table of an opened file are consistent
+  // with each other and lie inside the mapping
+  bool layout_valid() const {
+    const header &h = head();
+    if (!same_magic(h.magic) || h.version != format_version ||
+        h.element_size != sizeof(T) || h.used > mapped)
+      return false;
+    // Records of a block are addressed by a 32-bit ring position
+    if (h.block_capacity == 0 || h.block_capacity > UINT32_MAX ||
+        h.block_bytes < h.block_capacity * sizeof(T) ||
+        h.block_bytes > mapped)
+      return false;
+    if (h.table_offset < sizeof(header) || h.table_offset > mapped ||
+        h.table_capacity == 0 ||
+        h.table_capacity > (mapped - h.table_offset) / sizeof(entry) ||
+        h.table_head >= h.table_capacity || h.table_count > h.table_capacity)
+      return false;
+    if (h.free_head != 0 && (h.free_head < page || h.free_head > mapped ||
+                             mapped - h.free_head < h.block_bytes))
+      return false;
+    for (size_t b = 0; b < h.table_count; ++b) {
+      const entry &e = block_at(b);
+      if (e.offset < page || e.offset > mapped ||
+          mapped - e.offset < h.block_bytes || e.first >= h.block_capacity ||
+          e.count == 0 || e.count > h.block_capacity)
+        return false;
+      // operator[] relies on every block but the ends being full
+      if (b != 0 && b + 1 != h.table_count && e.count != h.block_capacity)
+        return false;
+    }
+    return true;
+  }
+
+  void close_file() {
+    if (base)
+      ::munmap(base, mapped);
+    if (fd >= 0)
+      ::close(fd);
+    base = nullptr;
+    fd = -1;
+  }
+
+public:
+  /**
+   * Open the deque stored at path, creating the file if it does not exist
+   * @param block_bytes Bytes per block for a new file, rounded up to whole
+   * pages; an existing file keeps the size it was created with
+   * @throw runtime_error if the file cannot be opened or mapped, holds a
+   * different format or record size, or its header or block table is
+   * truncated or corrupt
+   */
+  explicit persistent_deque(const char *path,
+                            durability m = durability::deferred,
+                            size_t block_bytes = 4096)
+      : fd(-1), base(nullptr), mapped(0),
+        page(size_t(::sysconf(_SC_PAGESIZE))), mode(m) {
+    fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+      throw runtime_error();
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      close_file();
+      throw runtime_error();
+    }
+    try {
+      if (st.st_size == 0) {
+        if (::ftruncate(fd, off_t(2 * page)) != 0)
+          throw runtime_error();
+        map(2 * page);
+        create(block_bytes);
+      } else {
+        if (size_t(st.st_size) < sizeof(header))
+          throw runtime_error();
+        map(size_t(st.st_size));
+        if (!layout_valid())
+          throw runtime_error();
+      }
+    } catch (...) {
+      close_file();
+      throw;
+    }
+  }
+
+  persistent_deque(const persistent_deque &) = delete;
+  persistent_deque &operator=(const persistent_deque &) = delete;
+
+  ~persistent_deque() { close_file(); }
+
+  /**
+   * Access an element with bounds checking
+   * @throw index_out_of_bound if pos >= size()
+   */
+  T &at(size_t pos) {
+    if (pos >= size())
+      throw index_out_of_bound();
+    return (*this)[pos];
+  }
+  const T &at(size_t pos) const {
+    if (pos >= size())
+      throw index_out_of_bound();
+    return (*this)[pos];
+  }
+
+  T &operator[](size_t pos) {
+    const entry &first = block_at(0);
+    if (pos < first.count)
+      return *record(first, pos);
+    pos -= first.count;
+    size_t capacity = head().block_capacity;
+    return *record(block_at(1 + pos / capacity), pos % capacity);
+  }
+  const T &operator[](size_t pos) const {
+    return const_cast<persistent_deque &>(*this)[pos];
+  }
+
+  /**
+   * @throw container_is_empty if empty
+   */
+  T &front() {
+    if (empty())
+      throw container_is_empty();
+    return *record(block_at(0), 0);
+  }
+  const T &front() const { return const_cast<persistent_deque &>(*this).front(); }
+
+  /**
+   * @throw container_is_empty if empty
+   */
+  T &back() {
+    if (empty())
+      throw container_is_empty();
+    const entry &last = block_at(head().table_count - 1);
+    return *record(last, last.count - 1);
+  }
+  const T &back() const { return const_cast<persistent_deque &>(*this).back(); }
+
+  bool empty() const { return head().table_count == 0; }
+
+  size_t size() const {
+    const header &h = head();
+    if (h.table_count == 0)
+      return 0;
+    if (h.table_count == 1)
+      return block_at(0).count;
+    return block_at(0).count + (h.table_count - 2) * h.block_capacity +
+           block_at(h.table_count - 1).count;
+  }
+
+  // Blocks in the deque
+  size_t block_count() const { return head().table_count; }
+
+  /**
+   * Append a record
+   * @throw runtime_error if the file cannot be extended, or in synchronous
+   * mode if the write cannot be synced
+   */
+  void push_back(const T &value) {
+    T copy = value; // value may live in the mapping, which can move
+    header &h = head();
+    if (h.table_count != 0 &&
+        block_at(h.table_count - 1).count < h.block_capacity) {
+      entry &last = block_at(h.table_count - 1);
+      T *slot = record(last, last.count);
+      std::memcpy(static_cast<void *>(slot), &copy, sizeof(T));
+      flush(slot, sizeof(T));
+      ++last.count;
+      flush(&last, sizeof(entry));
+      return;
+    }
+    if (h.table_count == h.table_capacity)
+      grow_table();
+    std::uint64_t slot = take_slot();
+    std::memcpy(base + slot, &copy, sizeof(T));
+    flush(base + slot, sizeof(T));
+    entry &e = block_at(head().table_count);
+    e.offset = slot;
+    e.first = 0;
+    e.count = 1;
+    flush(&e, sizeof(entry));
+    ++head().table_count;
+    flush_header();
+  }
+
+  /**
+   * Prepend a record
+   * @throw runtime_error if the file cannot be extended, or in synchronous
+   * mode if the write cannot be synced
+   */
+  void push_front(const T &value) {
+    T copy = value;
+    header &h = head();
+    if (h.table_count != 0 && block_at(0).count < h.block_capacity) {
+      entry &first = block_at(0);
+      std::uint32_t at = std::uint32_t(
+          (first.first + h.block_capacity - 1) % h.block_capacity);
+      T *slot = reinterpret_cast<T *>(base + first.offset) + at;
+      std::memcpy(static_cast<void *>(slot), &copy, sizeof(T));
+      flush(slot, sizeof(T));
+      first.first = at;
+      ++first.count;
+      flush(&first, sizeof(entry));
+      return;
+    }
+    if (h.table_count == h.table_capacity)
+      grow_table();
+    std::uint64_t slot = take_slot();
+    header &g = head();
+    std::uint32_t at = std::uint32_t(g.block_capacity - 1);
+    std::memcpy(base + slot + at * sizeof(T), &copy, sizeof(T));
+    flush(base + slot + at * sizeof(T), sizeof(T));
+    size_t ring_head = (g.table_head + g.table_capacity - 1) % g.table_capacity;
+    entry &e = reinterpret_cast<entry *>(base + g.table_offset)[ring_head];
+    e.offset = slot;
+    e.first = at;
+    e.count = 1;
+    flush(&e, sizeof(entry));
+    g.table_head = ring_head;
+    ++g.table_count;
+    flush_header();
+  }
+
+  /**
+   * Remove the last record
+   * @throw container_is_empty if empty
+   * @throw runtime_error in synchronous mode if the change cannot be synced
+   */
+  void pop_back() {
+    if (empty())
+      throw container_is_empty();
+    header &h = head();
+    entry &last = block_at(h.table_count - 1);
+    if (last.count > 1) {
+      --last.count;
+      flush(&last, sizeof(entry));
+      return;
+    }
+    std::uint64_t slot = last.offset;
+    --h.table_count;
+    flush_header();
+    free_slot(slot);
+  }
+
+  /**
+   * Remove the first record
+   * @throw container_is_empty if empty
+   * @throw runtime_error in synchronous mode if the change cannot be synced
+   */
+  void pop_front() {
+    if (empty())
+      throw container_is_empty();
+    header &h = head();
+    entry &first = block_at(0);
+    if (first.count > 1) {
+      first.first = std::uint32_t((first.first + 1) % h.block_capacity);
+      --first.count;
+      flush(&first, sizeof(entry));
+      return;
+    }
+    std::uint64_t slot = first.offset;
+    h.table_head = (h.table_head + 1) % h.table_capacity;
+    --h.table_count;
+    flush_header();
+    free_slot(slot);
+  }
+
+  // Remove every record; block slots go to the free list. Throws
+  // runtime_error in synchronous mode if the change cannot be synced.
+  void clear() {
+    header &h = head();
+    size_t blocks = h.table_count;
+    h.table_count = 0;
+    flush_header();
+    for (size_t b = 0; b < blocks; ++b)
+      free_slot(block_at(b).offset);
+  }
+
+  // Write every dirty page back to the file and wait for it
+  void sync() {
+    if (::msync(base, mapped, MS_SYNC) != 0)
+      throw runtime_error();
+  }
+};
+
+} // namespace sjtu
+
+#endif
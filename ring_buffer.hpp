@@ -0,0 +1,379 @@
+#ifndef SJTU_RING_BUFFER_HPP
+#define SJTU_RING_BUFFER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sjtu {
+
+/**
+ * Fixed-capacity circular buffer used as the storage of one deque block.
+ * Elements live contiguously in a single allocation, so pushes and pops at
+ * either end never allocate and indexed access is O(1). The buffer only
+ * reallocates when an insertion finds it full. Storage is obtained from
+ * Alloc, and elements are constructed and destroyed through it.
+ */
+template <class T, class Alloc = std::allocator<T>> class ring_buffer {
+private:
+  typedef std::allocator_traits<Alloc> traits;
+
+  T *buf;       // Raw storage for cap elements
+  size_t cap;   // Number of slots in buf
+  size_t head;  // Physical index of the first element
+  size_t count; // Number of constructed elements
+  Alloc alloc;  // Source of storage
+
+  // Map a logical index to its physical slot
+  size_t slot(size_t i) const {
+    i += head;
+    return i >= cap ? i - cap : i;
+  }
+
+  T *allocate(size_t n) {
+    if (n == 0)
+      return nullptr;
+    return std::addressof(*traits::allocate(alloc, n));
+  }
+
+  void deallocate(T *p, size_t n) {
+    if (p != nullptr)
+      traits::deallocate(alloc, p, n);
+  }
+
+  template <class... Args> void construct(T *p, Args &&...args) {
+    traits::construct(alloc, p, std::forward<Args>(args)...);
+  }
+
+  void destroy(T &x) { traits::destroy(alloc, std::addressof(x)); }
+
+  // Copy other's elements into this empty buffer, which must have room
+  void copy_elements(const ring_buffer &other) {
+    copy_elements(other, std::is_trivially_copyable<T>());
+  }
+
+  // Trivially copyable elements are copied as the (at most) two contiguous
+  // runs of other's storage
+  void copy_elements(const ring_buffer &other, std::true_type) {
+    if (other.count == 0)
+      return;
+    size_t first_run = std::min(other.count, other.cap - other.head);
+    std::memcpy(static_cast<void *>(buf), other.buf + other.head,
+                first_run * sizeof(T));
+    std::memcpy(static_cast<void *>(buf + first_run), other.buf,
+                (other.count - first_run) * sizeof(T));
+    head = 0;
+    count = other.count;
+  }
+
+  void copy_elements(const ring_buffer &other, std::false_type) {
+    for (size_t i = 0; i < other.count; ++i)
+      push_back(other[i]);
+  }
+
+  // Capacity to grow to when an insertion finds the buffer full
+  size_t grown_capacity() const { return cap == 0 ? 16 : cap * 2; }
+
+  // Grow storage so at least one more element fits
+  void grow() { reserve(grown_capacity()); }
+
+  /**
+   * Move all elements into fresh storage of n slots, starting at slot 0,
+   * and release the old storage
+   */
+  void relocate(T *fresh, size_t n) {
+    for (size_t i = 0; i < count; ++i) {
+      T &old = buf[slot(i)];
+      construct(fresh + i, std::move(old));
+      destroy(old);
+    }
+    deallocate(buf, cap);
+    buf = fresh;
+    cap = n;
+    head = 0;
+  }
+
+public:
+  explicit ring_buffer(const Alloc &a = Alloc())
+      : buf(nullptr), cap(0), head(0), count(0), alloc(a) {}
+
+  explicit ring_buffer(size_t capacity, const Alloc &a = Alloc())
+      : buf(nullptr), cap(capacity), head(0), count(0), alloc(a) {
+    buf = allocate(capacity);
+  }
+
+  ring_buffer(const ring_buffer &other)
+      : buf(nullptr), cap(other.cap), head(0), count(0),
+        alloc(traits::select_on_container_copy_construction(other.alloc)) {
+    buf = allocate(cap);
+    copy_elements(other);
+  }
+
+  // Take over other's storage, leaving it empty with no capacity
+  ring_buffer(ring_buffer &&other) noexcept
+      : buf(other.buf), cap(other.cap), head(other.head), count(other.count),
+        alloc(other.alloc) {
+    other.buf = nullptr;
+    other.cap = other.head = other.count = 0;
+  }
+
+  ring_buffer &operator=(const ring_buffer &other) {
+    if (this == &other)
+      return *this;
+    clear();
+    if (cap < other.count)
+      reserve(other.count);
+    copy_elements(other);
+    return *this;
+  }
+
+  ring_buffer &operator=(ring_buffer &&other) noexcept {
+    if (this == &other)
+      return *this;
+    clear();
+    deallocate(buf, cap);
+    buf = other.buf;
+    cap = other.cap;
+    head = other.head;
+    count = other.count;
+    alloc = other.alloc;
+    other.buf = nullptr;
+    other.cap = other.head = other.count = 0;
+    return *this;
+  }
+
+  ~ring_buffer() {
+    clear();
+    deallocate(buf, cap);
+  }
+
+  Alloc get_allocator() const { return alloc; }
+
+  size_t size() const { return count; }
+  size_t capacity() const { return cap; }
+  bool empty() const { return count == 0; }
+  bool full() const { return count == cap; }
+
+  T &operator[](size_t i) { return buf[slot(i)]; }
+  const T &operator[](size_t i) const { return buf[slot(i)]; }
+
+  // Elements occupy at most two contiguous runs of storage: from head up to
+  // the end of the allocation, then the part that wrapped around to slot 0
+
+  // Number of contiguous runs holding elements, 0 to 2
+  size_t runs() const {
+    return count == 0 ? 0 : count <= cap - head ? 1 : 2;
+  }
+
+  // First element of run r
+  T *run_data(size_t r) { return r == 0 ? buf + head : buf; }
+  const T *run_data(size_t r) const { return r == 0 ? buf + head : buf; }
+
+  // Number of elements in run r
+  size_t run_size(size_t r) const {
+    size_t first = std::min(count, cap - head);
+    return r == 0 ? first : count - first;
+  }
+
+  T &front() { return buf[head]; }
+  const T &front() const { return buf[head]; }
+  T &back() { return buf[slot(count - 1)]; }
+  const T &back() const { return buf[slot(count - 1)]; }
+
+  /**
+   * Make room for at least n elements, relocating existing ones to the
+   * start of a new allocation
+   * @param n Requested capacity
+   */
+  void reserve(size_t n) {
+    if (n <= cap)
+      return;
+    relocate(allocate(n), n);
+  }
+
+  /**
+   * Construct an element in place after the last one. When the buffer is
+   * full the element is built in the new storage before the old elements
+   * move, so arguments may refer to elements of this buffer.
+   * @return Reference to the new element
+   */
+  template <class... Args> T &emplace_back(Args &&...args) {
+    if (count == cap) {
+      size_t n = grown_capacity();
+      T *fresh = allocate(n);
+      try {
+        construct(fresh + count, std::forward<Args>(args)...);
+      } catch (...) {
+        deallocate(fresh, n);
+        throw;
+      }
+      relocate(fresh, n);
+    } else {
+      construct(buf + slot(count), std::forward<Args>(args)...);
+    }
+    ++count;
+    return back();
+  }
+
+  /**
+   * Construct an element in place before the first one
+   * @return Reference to the new element
+   */
+  template <class... Args> T &emplace_front(Args &&...args) {
+    if (count == cap) {
+      size_t n = grown_capacity();
+      T *fresh = allocate(n);
+      try {
+        construct(fresh + n - 1, std::forward<Args>(args)...);
+      } catch (...) {
+        deallocate(fresh, n);
+        throw;
+      }
+      relocate(fresh, n);
+      head = n - 1;
+    } else {
+      size_t h = head == 0 ? cap - 1 : head - 1;
+      construct(buf + h, std::forward<Args>(args)...);
+      head = h;
+    }
+    ++count;
+    return front();
+  }
+
+  void push_back(const T &val) { emplace_back(val); }
+  void push_back(T &&val) { emplace_back(std::move(val)); }
+
+  void push_front(const T &val) { emplace_front(val); }
+  void push_front(T &&val) { emplace_front(std::move(val)); }
+
+  void pop_back() {
+    destroy(buf[slot(count - 1)]);
+    --count;
+  }
+
+  void pop_front() {
+    destroy(buf[head]);
+    head = slot(1);
+    --count;
+    if (count == 0)
+      head = 0;
+  }
+
+  /**
+   * Construct an element before logical position pos, shifting whichever
+   * side of the buffer is shorter
+   * @param pos Logical index in [0, size()]
+   * @param args Constructor arguments for the new element
+   */
+  template <class... Args> void emplace(size_t pos, Args &&...args) {
+    if (pos == count) {
+      emplace_back(std::forward<Args>(args)...);
+      return;
+    }
+    if (pos == 0) {
+      emplace_front(std::forward<Args>(args)...);
+      return;
+    }
+    T tmp(std::forward<Args>(args)...);
+    if (count == cap)
+      grow();
+    if (pos < count - pos) {
+      // Shift the prefix one slot towards the front
+      size_t h = head == 0 ? cap - 1 : head - 1;
+      construct(buf + h, std::move(buf[head]));
+      head = h;
+      ++count;
+      for (size_t i = 1; i < pos; ++i)
+        (*this)[i] = std::move((*this)[i + 1]);
+    } else {
+      // Shift the suffix one slot towards the back
+      construct(buf + slot(count), std::move(back()));
+      ++count;
+      for (size_t i = count - 2; i > pos; --i)
+        (*this)[i] = std::move((*this)[i - 1]);
+    }
+    (*this)[pos] = std::move(tmp);
+  }
+
+  void insert(size_t pos, const T &val) { emplace(pos, val); }
+  void insert(size_t pos, T &&val) { emplace(pos, std::move(val)); }
+
+  /**
+   * Remove the element at logical position pos, shifting whichever side of
+   * the buffer is shorter
+   * @param pos Logical index in [0, size())
+   */
+  void erase(size_t pos) {
+    if (pos < count - 1 - pos) {
+      for (size_t i = pos; i > 0; --i)
+        (*this)[i] = std::move((*this)[i - 1]);
+      pop_front();
+    } else {
+      for (size_t i = pos; i + 1 < count; ++i)
+        (*this)[i] = std::move((*this)[i + 1]);
+      pop_back();
+    }
+  }
+
+  /**
+   * Remove the elements at logical positions [first, last), shifting
+   * whichever side of the buffer is shorter
+   * @param first Logical index of the first element to remove
+   * @param last Logical index past the last element to remove
+   */
+  void erase(size_t first, size_t last) {
+    size_t k = last - first;
+    if (first < count - last) {
+      // Move the prefix k slots towards the back
+      for (size_t i = first; i > 0; --i)
+        (*this)[i - 1 + k] = std::move((*this)[i - 1]);
+      for (size_t i = 0; i < k; ++i)
+        pop_front();
+    } else {
+      for (size_t i = last; i < count; ++i)
+        (*this)[i - k] = std::move((*this)[i]);
+      for (size_t i = 0; i < k; ++i)
+        pop_back();
+    }
+  }
+
+  // Destroy all elements, keeping the storage
+  void clear() {
+    for (size_t i = 0; i < count; ++i)
+      destroy(buf[slot(i)]);
+    head = count = 0;
+  }
+
+  /**
+   * Move every element of other to the back of this buffer
+   * @param other Buffer to drain
+   */
+  void splice(ring_buffer &other) { splice(other, 0); }
+
+  /**
+   * Move the elements other[first, other.size()) to the back of this buffer
+   * @param other Buffer to take elements from
+   * @param first Logical index of the first element to move
+   */
+  void splice(ring_buffer &other, size_t first) {
+    size_t moved = other.count - first;
+    if (count + moved > cap)
+      reserve(count + moved);
+    for (size_t i = first; i < other.count; ++i) {
+      T &src = other[i];
+      construct(buf + slot(count), std::move(src));
+      destroy(src);
+      ++count;
+    }
+    other.count = first;
+    if (first == 0)
+      other.head = 0;
+  }
+};
+
+} // namespace sjtu
+
+#endif
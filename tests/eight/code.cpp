@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include "deque.hpp"
+
+// Copy construction and copy assignment, for trivially copyable elements
+// (copied a block at a time) and for others, between deques of different
+// sizes and shapes.
+
+std::mt19937 rng(10);
+
+struct point {
+    int x, y;
+    bool operator!=(const point &o) const { return x != o.x || y != o.y; }
+};
+
+int make(int i, int) { return i; }
+point make(int i, point) { return point{i, -i}; }
+std::string make(int i, std::string) { return std::to_string(i); }
+
+template <class T>
+bool same(const sjtu::deque<T> &q, const std::deque<T> &stl) {
+    if (q.size() != stl.size()) return false;
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i] != stl[i]) return false;
+    return true;
+}
+
+// A deque of n elements with a mix of front and back pushes and middle
+// inserts, so its blocks wrap around and differ in size
+template <class T>
+void build(sjtu::deque<T> &q, std::deque<T> &stl, size_t n) {
+    q.clear();
+    stl.clear();
+    for (size_t i = 0; i < n; ++i) {
+        T v = make(int(rng() % 100000), T());
+        switch (rng() % 3) {
+        case 0: q.push_back(v); stl.push_back(v); break;
+        case 1: q.push_front(v); stl.push_front(v); break;
+        default: {
+            size_t pos = rng() % (stl.size() + 1);
+            q.insert(q.begin() + pos, v);
+            stl.insert(stl.begin() + pos, v);
+        }
+        }
+    }
+}
+
+template <class T> bool run() {
+    const size_t sizes[] = {0, 1, 199, 5000, 40000};
+    for (size_t a : sizes)
+        for (size_t b : sizes) {
+            sjtu::deque<T> p, q;
+            std::deque<T> sp, sq;
+            build(p, sp, a);
+            build(q, sq, b);
+            sjtu::deque<T> c(p);
+            if (!same(c, sp)) return false;
+            q = p;
+            if (!same(q, sp) || !same(p, sp)) return false;
+            // Copies are independent of their source
+            if (a > 0) {
+                p[0] = make(-1, T());
+                if (!same(q, sp) || !same(c, sp)) return false;
+            }
+            q = q;
+            if (!same(q, sp)) return false;
+        }
+    return true;
+}
+
+int main() {
+    puts(run<int>() ? "int: ok" : "int: FAIL");
+    puts(run<point>() ? "point: ok" : "point: FAIL");
+    puts(run<std::string>() ? "string: ok" : "string: FAIL");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#define SJTU_DEQUE_STATS
+#include <cstdio>
+#include <deque>
+#include <random>
+#include "deque.hpp"
+
+// The block index caches the last block found. Mix operations that move
+// elements in front of and inside the cached block, or restructure the
+// blocks, with forward, backward and strided d[i] scans, and compare every
+// element with std::deque. A sequential scan must stay O(1) per step.
+
+std::mt19937 rng(25);
+
+sjtu::deque<int> q;
+std::deque<int> stl;
+bool ok = true;
+
+void scan(int kind) {
+    size_t n = stl.size();
+    const sjtu::deque<int> &c = q;
+    if (kind == 0) {
+        for (size_t i = 0; i < n; ++i)
+            if (q[i] != stl[i]) ok = false;
+    } else if (kind == 1) {
+        for (size_t i = n; i-- > 0;)
+            if (q[i] != stl[i]) ok = false;
+    } else if (kind == 2) {
+        size_t stride = 1 + rng() % 300;
+        for (size_t i = rng() % (stride + 1); i < n; i += stride)
+            if (q[i] != stl[i]) ok = false;
+    } else if (kind == 3) {
+        // Const lookups read the cache without moving it
+        for (size_t i = 0; i < n; i += 1 + rng() % 5)
+            if (c[i] != stl[i] || c.at(i) != stl[i]) ok = false;
+    } else {
+        for (int k = 0; k < 200 && n > 0; ++k) {
+            size_t i = rng() % n;
+            if (q[i] != stl[i]) ok = false;
+        }
+    }
+    if (n > 0 && (q[0] != stl[0] || q[n - 1] != stl[n - 1])) ok = false;
+}
+
+// One change to the deque; a lookup first puts the cache at a random block
+void change() {
+    if (!stl.empty()) (void)q[rng() % stl.size()];
+    int v = int(rng() % 1000000);
+    size_t n = stl.size();
+    switch (rng() % 10) {
+    case 0: q.push_back(v), stl.push_back(v); break;
+    case 1: q.push_front(v), stl.push_front(v); break;
+    case 2:
+        if (n) q.pop_back(), stl.pop_back();
+        break;
+    case 3:
+        if (n) q.pop_front(), stl.pop_front();
+        break;
+    case 4: {
+        size_t p = rng() % (n + 1);
+        q.insert(q.begin() + long(p), v);
+        stl.insert(stl.begin() + long(p), v);
+        break;
+    }
+    case 5:
+        if (n) {
+            size_t a = rng() % n, b = a + rng() % std::min<size_t>(n - a, 700);
+            q.erase(q.begin() + long(a), q.begin() + long(b));
+            stl.erase(stl.begin() + long(a), stl.begin() + long(b));
+        }
+        break;
+    case 6:
+        if (n) {
+            size_t p = rng() % n;
+            q.erase(q.begin() + long(p));
+            stl.erase(stl.begin() + long(p));
+        }
+        break;
+    case 7:
+        for (int k = 0; k < 300; ++k) q.push_back(v + k), stl.push_back(v + k);
+        break;
+    case 8: {
+        size_t k = n ? rng() % std::min<size_t>(n, 300) : 0;
+        q.erase_front(k);
+        stl.erase(stl.begin(), stl.begin() + long(k));
+        break;
+    }
+    default:
+        if (rng() % 20 == 0) q.compact();
+        else for (int k = 0; k < 300; ++k) q.push_front(v - k), stl.push_front(v - k);
+    }
+}
+
+int main() {
+    // Tiny deques: one block, and positions at both ends
+    for (int i = 0; i < 40 && ok; ++i) {
+        q.push_back(i), stl.push_back(i);
+        for (int kind = 0; kind < 5; ++kind) scan(kind);
+        q.push_front(-i), stl.push_front(-i);
+        scan(1);
+    }
+    while (!stl.empty() && ok) {
+        q.pop_back(), stl.pop_back();
+        scan(0);
+        if (!stl.empty()) q.pop_front(), stl.pop_front(), scan(1);
+    }
+    puts(ok ? "small: ok" : "small: FAIL");
+
+    for (int i = 0; i < 50000; ++i) q.push_back(i), stl.push_back(i);
+    for (int step = 0; step < 3000 && ok; ++step) {
+        change();
+        scan(int(rng() % 5));
+    }
+    puts(ok ? "mixed: ok" : "mixed: FAIL");
+
+    // Push and pop in front of and inside the cached block, then read near it
+    for (int step = 0; step < 20000 && ok; ++step) {
+        size_t n = stl.size();
+        size_t p = rng() % n;
+        (void)q[p];
+        switch (rng() % 4) {
+        case 0: q.push_front(step), stl.push_front(step), ++p; break;
+        case 1: q.pop_front(), stl.pop_front(), p = p ? p - 1 : 0; break;
+        case 2: q.push_back(step), stl.push_back(step); break;
+        default: q.pop_back(), stl.pop_back();
+        }
+        for (size_t i = p > 3 ? p - 3 : 0; i < p + 3 && i < stl.size(); ++i)
+            if (q[i] != stl[i]) ok = false;
+        while (stl.size() < 1000) q.push_back(step), stl.push_back(step);
+    }
+    puts(ok ? "ends: ok" : "ends: FAIL");
+
+    // Clearing drops the cache along with the blocks
+    q.clear(), stl.clear();
+    for (int i = 0; i < 5000; ++i) q.push_front(i), stl.push_front(i);
+    scan(0), scan(1), scan(2);
+    puts(ok ? "clear: ok" : "clear: FAIL");
+
+    // Sequential scans probe a bounded number of index entries per step
+    sjtu::deque_stats before = q.stats();
+    for (size_t i = 0; i < stl.size(); ++i) ok = ok && q[i] == stl[i];
+    for (size_t i = stl.size(); i-- > 0;) ok = ok && q[i] == stl[i];
+    sjtu::deque_stats after = q.stats();
+    size_t calls = after.at_calls - before.at_calls;
+    size_t probes = after.at_blocks_visited - before.at_blocks_visited;
+    ok = ok && calls == 2 * stl.size() && probes <= 2 * calls + 64;
+    puts(ok ? "probes: ok" : "probes: FAIL");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "deque.hpp"
+#include "deque_parallel.hpp"
+
+// Parallel for_each, transform and reduce on 4 threads against the same
+// loops over std::deque. The reduce uses string concatenation, which is
+// associative but not commutative, so element order is checked too.
+
+std::mt19937 rng(16);
+
+bool for_each_and_transform(sjtu::work_stealing_pool &pool) {
+    sjtu::deque<long> q;
+    std::deque<long> stl;
+    for (int i = 0; i < 300000; ++i) {
+        long v = long(rng() % 1000);
+        if (i % 3) q.push_back(v), stl.push_back(v);
+        else q.push_front(v), stl.push_front(v);
+    }
+    sjtu::parallel_for_each(pool, q, [](long &x) { x = x * 3 + 1; });
+    for (long &x : stl) x = x * 3 + 1;
+    std::atomic<long> sum(0);
+    sjtu::parallel_for_each(pool, static_cast<const sjtu::deque<long> &>(q),
+                            [&](const long &x) { sum.fetch_add(x); });
+    long expect = 0;
+    for (long x : stl) expect += x;
+    if (sum.load() != expect) return false;
+
+    sjtu::parallel_transform(pool, q, [](long x) { return x % 7; });
+    for (long &x : stl) x %= 7;
+    std::vector<long> out(stl.size());
+    auto end = sjtu::parallel_transform(
+        pool, static_cast<const sjtu::deque<long> &>(q), out.begin(),
+        [](const long &x) { return x * x; });
+    if (end != out.end()) return false;
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i] != stl[i] || out[i] != stl[i] * stl[i]) return false;
+    return true;
+}
+
+bool reduce(sjtu::work_stealing_pool &pool) {
+    for (size_t n : {size_t(0), size_t(1), size_t(5000), size_t(100000)}) {
+        sjtu::deque<std::string> q;
+        std::string expect = ">";
+        for (size_t i = 0; i < n; ++i) {
+            std::string s(1, char('a' + rng() % 26));
+            q.push_back(s);
+            expect += s;
+        }
+        std::string got = sjtu::parallel_reduce(
+            pool, q, std::string(">"),
+            [](std::string a, const std::string &b) { return a += b; });
+        if (got != expect) return false;
+    }
+    return true;
+}
+
+int main() {
+    sjtu::work_stealing_pool pool(4);
+    puts(for_each_and_transform(pool) ? "for_each/transform: ok"
+                                      : "for_each/transform: FAIL");
+    puts(reduce(pool) ? "reduce: ok" : "reduce: FAIL");
+    return 0;
+}
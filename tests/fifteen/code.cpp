@@ -0,0 +1,166 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <sstream>
+#include <string>
+#include "class-bint.hpp"
+#include "class-matrix.hpp"
+#include "deque.hpp"
+#include "deque_serialize.hpp"
+
+// Serialization round trips against std::deque for raw and encoded element
+// types, then truncated and corrupted streams, which must fail with
+// runtime_error and leave the target deque untouched.
+
+std::mt19937 rng(21);
+
+// Offsets in a stream: the header is 32 bytes, then the first record's
+// element count and byte length
+const size_t COUNT_AT = 32, BYTES_AT = 40, PAYLOAD_AT = 48;
+
+// A stream that cannot seek, like a pipe
+class pipe_buf : public std::stringbuf {
+public:
+    explicit pipe_buf(const std::string &s) : std::stringbuf(s, std::ios::in) {}
+
+protected:
+    pos_type seekoff(off_type, std::ios::seekdir, std::ios::openmode) override {
+        return pos_type(off_type(-1));
+    }
+    pos_type seekpos(pos_type, std::ios::openmode) override {
+        return pos_type(off_type(-1));
+    }
+};
+
+template <class T>
+bool same(const sjtu::deque<T> &q, const std::deque<T> &stl) {
+    if (q.size() != stl.size()) return false;
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (!(q[i] == stl[i])) return false;
+    return true;
+}
+
+template <class T, class Make> bool round_trip(size_t n, Make make) {
+    sjtu::deque<T> q;
+    std::deque<T> stl;
+    for (size_t i = 0; i < n; ++i) {
+        T v = make(i);
+        if (i % 3) q.push_back(v), stl.push_back(v);
+        else q.push_front(v), stl.push_front(v);
+    }
+    std::stringstream buf;
+    sjtu::save(buf, q);
+    sjtu::deque<T> back;
+    back.push_back(make(0));
+    sjtu::load(buf, back);
+    if (!same(back, stl)) return false;
+
+    // The block table points at every record, and the counts add up
+    std::istringstream in(buf.str());
+    size_t total = 0;
+    for (auto b : sjtu::deque_reader<T>::block_table(in)) total += b.count;
+    return total == n;
+}
+
+bool streaming() {
+    std::stringstream buf;
+    sjtu::deque_writer<int> writer(buf);
+    std::deque<int> stl;
+    for (int b = 0; b < 50; ++b) {
+        int block[100];
+        for (int &x : block) stl.push_back(x = int(rng()));
+        writer.write_block(block, 100);
+    }
+    writer.finish();
+    sjtu::deque_reader<int> reader(buf);
+    sjtu::deque<int> q;
+    size_t blocks = 0;
+    while (reader.read_block(q) != 0) ++blocks;
+    return blocks == 50 && same(q, stl);
+}
+
+// Load data into a deque holding one marker; it must throw runtime_error
+// and keep the marker
+template <class T> bool rejected(const std::string &data, bool seekable) {
+    pipe_buf pipe(data);
+    std::istringstream text(data);
+    std::istream piped(&pipe);
+    std::istream &in = seekable ? static_cast<std::istream &>(text) : piped;
+    sjtu::deque<T> q;
+    q.push_back(T());
+    try {
+        sjtu::load(in, q);
+    } catch (sjtu::runtime_error &) {
+        return q.size() == 1;
+    } catch (...) {
+        return false;
+    }
+    return false;
+}
+
+void put(std::string &s, size_t at, std::uint64_t v) { std::memcpy(&s[at], &v, sizeof(v)); }
+
+template <class T> std::string saved(size_t n) {
+    sjtu::deque<T> q;
+    for (size_t i = 0; i < n; ++i) q.push_back(T());
+    std::ostringstream out;
+    sjtu::save(out, q);
+    return out.str();
+}
+
+bool truncated() {
+    std::string ints = saved<int>(1000), strings = saved<std::string>(300);
+    for (size_t cut = 0; cut < ints.size(); cut += 7)
+        if (!rejected<int>(ints.substr(0, cut), cut % 2)) return false;
+    for (size_t cut = 0; cut < strings.size(); cut += 5)
+        if (!rejected<std::string>(strings.substr(0, cut), cut % 2)) return false;
+    return true;
+}
+
+bool corrupted() {
+    const std::uint64_t huge[] = {std::uint64_t(1) << 40, std::uint64_t(-1) / 2,
+                                  std::uint64_t(-1)};
+    for (std::uint64_t bad : huge)
+        for (bool seekable : {true, false}) {
+            std::string s = saved<int>(1000);
+            put(s, COUNT_AT, bad);
+            if (!rejected<int>(s, seekable)) return false;
+            s = saved<int>(1000);
+            put(s, BYTES_AT, bad);
+            if (!rejected<int>(s, seekable)) return false;
+            put(s, COUNT_AT, bad / sizeof(int));
+            put(s, BYTES_AT, bad / sizeof(int) * sizeof(int));
+            if (!rejected<int>(s, seekable)) return false;
+            s = saved<std::string>(300);
+            put(s, BYTES_AT, bad);
+            if (!rejected<std::string>(s, seekable)) return false;
+            s = saved<std::string>(300);
+            put(s, PAYLOAD_AT, bad); // Length of the first string
+            if (!rejected<std::string>(s, seekable)) return false;
+            s = saved<Diamond::Matrix<double>>(3);
+            put(s, PAYLOAD_AT, bad); // Row count of the first matrix
+            if (!rejected<Diamond::Matrix<double>>(s, seekable)) return false;
+        }
+    return true;
+}
+
+int main() {
+    bool ok = round_trip<int>(0, [](size_t i) { return int(i); }) &&
+              round_trip<int>(100000, [](size_t) { return int(rng()); });
+    puts(ok ? "raw: ok" : "raw: FAIL");
+    ok = round_trip<std::string>(20000, [](size_t i) { return std::string(i % 50, 'a' + i % 26); }) &&
+         round_trip<Util::Bint>(3000, [](size_t i) { return Util::Bint((long long)(i * i * 7919)) * Util::Bint((long long)rng()); }) &&
+         round_trip<Diamond::Matrix<double>>(500, [](size_t i) {
+             Diamond::Matrix<double> m(i % 4 + 1, i % 3 + 1);
+             for (size_t r = 0; r < m.RowSize(); ++r)
+                 for (size_t c = 0; c < m.ColSize(); ++c) m[r][c] = double(rng()) / 7;
+             return m;
+         });
+    puts(ok ? "encoded: ok" : "encoded: FAIL");
+    puts(streaming() ? "streaming: ok" : "streaming: FAIL");
+    puts(truncated() ? "truncated: ok" : "truncated: FAIL");
+    puts(corrupted() ? "corrupted: ok" : "corrupted: FAIL");
+    return 0;
+}
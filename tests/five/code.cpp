@@ -0,0 +1,86 @@
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "work_stealing_deque.hpp"
+#include "work_stealing_pool.hpp"
+
+// Stress test for work_stealing_deque: one owner pushes and pops while
+// thieves steal, and every value must be taken exactly once.
+
+const int THIEVES = 3;
+const int ROUNDS = 20;
+const int N = 100000;
+
+bool stress(int round) {
+    sjtu::work_stealing_deque<long> q(2); // tiny ring, so pushes grow it
+    std::vector<std::atomic<int>> seen(N);
+    for (auto &s : seen) s.store(0);
+    std::atomic<bool> done(false);
+    std::atomic<long> stolen(0);
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < THIEVES; ++i)
+        thieves.emplace_back([&] {
+            long x;
+            for (;;) {
+                bool finished = done.load();
+                if (q.steal(x)) {
+                    seen[x].fetch_add(1);
+                    stolen.fetch_add(1);
+                } else if (finished && q.empty()) {
+                    return;
+                }
+            }
+        });
+
+    long x;
+    long popped = 0;
+    for (int i = 0; i < N; ++i) {
+        q.push(i);
+        // Pop in bursts of varying length, so the owner often races the
+        // thieves for the last element
+        if ((i + round) % 3 == 0)
+            for (int k = 0; k < (i % 5) && q.pop(x); ++k) {
+                seen[x].fetch_add(1);
+                ++popped;
+            }
+    }
+    while (q.pop(x)) {
+        seen[x].fetch_add(1);
+        ++popped;
+    }
+    done.store(true);
+    for (auto &t : thieves) t.join();
+
+    for (int i = 0; i < N; ++i)
+        if (seen[i].load() != 1) {
+            printf("value %d taken %d times\n", i, seen[i].load());
+            return false;
+        }
+    return popped + stolen.load() == N;
+}
+
+bool pool_sum() {
+    sjtu::work_stealing_pool pool(4);
+    const size_t n = 1000000;
+    std::vector<long> v(n);
+    pool.parallel_for(n, 1000, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) v[i] = long(i) * 3;
+    });
+    std::atomic<long> sum(0);
+    pool.parallel_for(n, 997, [&](size_t lo, size_t hi) {
+        long s = 0;
+        for (size_t i = lo; i < hi; ++i) s += v[i];
+        sum.fetch_add(s);
+    });
+    return sum.load() == long(n) * long(n - 1) / 2 * 3;
+}
+
+int main() {
+    bool ok = true;
+    for (int r = 0; r < ROUNDS && ok; ++r) ok = stress(r);
+    puts(ok ? "stress: ok" : "stress: FAIL");
+    puts(pool_sum() ? "pool: ok" : "pool: FAIL");
+    return 0;
+}
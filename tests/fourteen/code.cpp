@@ -0,0 +1,164 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include "persistent_deque.hpp"
+#include "exceptions.hpp"
+
+// persistent_deque against std::deque, closing and reopening the file
+// between rounds, in both durability modes. A reopened file must hold
+// exactly what was there before it was closed, and a truncated or corrupt
+// file must be rejected with runtime_error.
+
+const char *PATH = "fourteen.dat";
+
+std::mt19937 rng(20);
+
+struct trade {
+    long id;
+    double price;
+};
+
+typedef sjtu::persistent_deque<trade> store;
+
+bool same(const store &q, const std::deque<long> &stl) {
+    if (q.size() != stl.size() || q.empty() != stl.empty()) return false;
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i].id != stl[i] || q.at(i).price != stl[i] * 0.5) return false;
+    return stl.empty() || (q.front().id == stl.front() && q.back().id == stl.back());
+}
+
+bool rounds(store::durability mode, int count, int ops) {
+    std::remove(PATH);
+    std::deque<long> stl;
+    long next = 0;
+    for (int round = 0; round < count; ++round) {
+        store q(PATH, mode);
+        if (!same(q, stl)) return false;
+        for (int i = 0; i < ops; ++i) {
+            trade t{next, next * 0.5};
+            switch (rng() % 5) {
+            case 0: case 1: q.push_back(t); stl.push_back(next++); break;
+            case 2: q.push_front(t); stl.push_front(next++); break;
+            case 3: if (!stl.empty()) { q.pop_front(); stl.pop_front(); } break;
+            default: if (!stl.empty()) { q.pop_back(); stl.pop_back(); }
+            }
+        }
+        if (round % 4 == 3) {
+            q.clear();
+            stl.clear();
+        }
+        if (!same(q, stl)) return false;
+        q.sync();
+    }
+    std::remove(PATH);
+    return true;
+}
+
+bool errors() {
+    std::remove(PATH);
+    int thrown = 0;
+    {
+        store q(PATH);
+        try { q.front(); } catch (sjtu::container_is_empty &) { ++thrown; }
+        try { q.pop_back(); } catch (sjtu::container_is_empty &) { ++thrown; }
+        q.push_back(trade{1, 0.5});
+        try { q.at(1); } catch (sjtu::index_out_of_bound &) { ++thrown; }
+    }
+    // A file of 16-byte records cannot be opened as 8-byte records
+    try { sjtu::persistent_deque<long> wrong(PATH); } catch (sjtu::runtime_error &) { ++thrown; }
+    std::remove(PATH);
+    return thrown == 4;
+}
+
+std::string slurp() {
+    std::ifstream in(PATH, std::ios::binary);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+void spill(const std::string &bytes) {
+    std::ofstream out(PATH, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+std::uint64_t get(const std::string &s, size_t at) {
+    std::uint64_t v;
+    std::memcpy(&v, &s[at], sizeof(v));
+    return v;
+}
+
+void put(std::string &s, size_t at, std::uint64_t v) { std::memcpy(&s[at], &v, sizeof(v)); }
+
+bool rejected(const std::string &bytes) {
+    spill(bytes);
+    try {
+        store q(PATH);
+    } catch (sjtu::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+// Header fields, as byte offsets into the file
+const size_t BLOCK_CAPACITY = 16, BLOCK_BYTES = 24, FREE_HEAD = 40, TABLE_OFFSET = 48,
+             TABLE_CAPACITY = 56, TABLE_HEAD = 64, TABLE_COUNT = 72;
+
+bool corrupt() {
+    std::remove(PATH);
+    {
+        store q(PATH);
+        for (long i = 0; i < 2000; ++i) q.push_back(trade{i, i * 0.5});
+        for (long i = 0; i < 300; ++i) q.pop_front();
+        q.sync();
+    }
+    const std::string good = slurp();
+    const std::uint64_t table = get(good, TABLE_OFFSET), capacity = get(good, TABLE_CAPACITY),
+                        head = get(good, TABLE_HEAD), count = get(good, TABLE_COUNT);
+    // Byte offset of table entry b, whose slot offset comes first and its
+    // record count at +12
+    auto entry = [&](std::uint64_t b) { return size_t(table + (head + b) % capacity * 16); };
+    if (count < 4) return false;
+
+    int bad = 0, cases = 0;
+    std::string s;
+    auto expect = [&](const std::string &bytes) { ++cases, bad += !rejected(bytes); };
+    s = good, put(s, BLOCK_CAPACITY, 0), expect(s);
+    s = good, put(s, BLOCK_CAPACITY, get(good, BLOCK_BYTES)), expect(s);
+    s = good, put(s, BLOCK_BYTES, 0), expect(s);
+    s = good, put(s, TABLE_CAPACITY, 0), expect(s);
+    s = good, put(s, TABLE_CAPACITY, std::uint64_t(1) << 60), expect(s);
+    s = good, put(s, TABLE_OFFSET, good.size() - 8), expect(s);
+    s = good, put(s, TABLE_OFFSET, std::uint64_t(-16)), expect(s);
+    s = good, put(s, TABLE_HEAD, capacity), expect(s);
+    s = good, put(s, TABLE_COUNT, capacity + 1), expect(s);
+    s = good, put(s, FREE_HEAD, good.size() + 4096), expect(s);
+    s = good, put(s, entry(0), good.size()), expect(s);
+    s = good, put(s, entry(count - 1), std::uint64_t(-4096)), expect(s);
+    s = good, put(s, entry(1) + 8, get(good, entry(1) + 8) - (std::uint64_t(1) << 32)), expect(s);
+    s = good.substr(0, good.size() / 2), expect(s);
+    s = good.substr(0, 100), expect(s);
+
+    // The untouched file still opens and holds what was written
+    spill(good);
+    bool ok = false;
+    {
+        store q(PATH);
+        ok = q.size() == 1700 && q.front().id == 300 && q.back().id == 1999 && q[850].id == 1150;
+    }
+    std::remove(PATH);
+    return ok && cases == 15 && bad == 0;
+}
+
+int main() {
+    puts(rounds(store::durability::deferred, 24, 20000) ? "deferred: ok" : "deferred: FAIL");
+    puts(rounds(store::durability::synchronous, 6, 2000) ? "synchronous: ok" : "synchronous: FAIL");
+    puts(errors() ? "errors: ok" : "errors: FAIL");
+    puts(corrupt() ? "corrupt: ok" : "corrupt: FAIL");
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <deque>
+#include <random>
+#include "deque.hpp"
+#include "exceptions.hpp"
+
+// Range erase, erase_front and erase_back against std::deque, including
+// empty ranges, whole-deque ranges and the exceptions for bad arguments.
+
+std::mt19937 rng(14);
+
+bool same(const sjtu::deque<long> &q, const std::deque<long> &stl) {
+    if (q.size() != stl.size()) return false;
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i] != stl[i]) return false;
+    return true;
+}
+
+void refill(sjtu::deque<long> &q, std::deque<long> &stl, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        long v = long(rng());
+        if (i % 2) q.push_back(v), stl.push_back(v);
+        else q.push_front(v), stl.push_front(v);
+    }
+}
+
+bool range_erase() {
+    sjtu::deque<long> q;
+    std::deque<long> stl;
+    for (int round = 0; round < 400; ++round) {
+        if (stl.size() < 20000) refill(q, stl, rng() % 30000);
+        size_t a = rng() % (stl.size() + 1);
+        size_t len = round % 4 == 0 ? 0 : rng() % (stl.size() - a + 1);
+        if (round % 50 == 0) a = 0, len = stl.size();
+        auto it = q.erase(q.begin() + a, q.begin() + (a + len));
+        stl.erase(stl.begin() + a, stl.begin() + (a + len));
+        if (it - q.begin() != long(a) || !same(q, stl)) return false;
+        if (a < stl.size() && *it != stl[a]) return false;
+    }
+    return true;
+}
+
+bool end_erase() {
+    sjtu::deque<long> q;
+    std::deque<long> stl;
+    for (int round = 0; round < 400; ++round) {
+        if (stl.size() < 20000) refill(q, stl, rng() % 30000);
+        size_t n = round % 7 == 0 ? stl.size() : rng() % (stl.size() + 1);
+        if (round % 2) {
+            q.erase_front(n);
+            stl.erase(stl.begin(), stl.begin() + n);
+        } else {
+            q.erase_back(n);
+            stl.erase(stl.end() - n, stl.end());
+        }
+        if (!same(q, stl)) return false;
+        q.push_back(round), stl.push_back(round);
+    }
+    return true;
+}
+
+bool bad_arguments() {
+    sjtu::deque<long> q, other;
+    std::deque<long> stl;
+    refill(q, stl, 1000);
+    other.push_back(1);
+    int thrown = 0;
+    try { q.erase_front(1001); } catch (sjtu::index_out_of_bound &) { ++thrown; }
+    try { q.erase_back(1001); } catch (sjtu::index_out_of_bound &) { ++thrown; }
+    try { q.erase(q.begin() + 5, q.begin() + 2); } catch (sjtu::invalid_iterator &) { ++thrown; }
+    try { q.erase(other.begin(), other.end()); } catch (sjtu::invalid_iterator &) { ++thrown; }
+    return thrown == 4 && same(q, stl);
+}
+
+int main() {
+    puts(range_erase() ? "erase range: ok" : "erase range: FAIL");
+    puts(end_erase() ? "erase ends: ok" : "erase ends: FAIL");
+    puts(bad_arguments() ? "bad arguments: ok" : "bad arguments: FAIL");
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <random>
+#include "deque.hpp"
+
+// Rvalue and emplace insertion: a move-only element type, an element type
+// that counts its copies and moves, and emplace(pos, args...) landing at pos
+// at the front, in the middle and at the back, all checked against std::deque.
+
+std::mt19937 rng(4);
+
+struct tracked {
+    static long copies, moves, alive;
+    int a, b;
+    tracked(int a, int b) : a(a), b(b) { ++alive; }
+    tracked(const tracked &o) : a(o.a), b(o.b) { ++copies, ++alive; }
+    tracked(tracked &&o) noexcept : a(o.a), b(o.b) { ++moves, ++alive; }
+    tracked &operator=(const tracked &o) { a = o.a, b = o.b, ++copies; return *this; }
+    tracked &operator=(tracked &&o) noexcept { a = o.a, b = o.b, ++moves; return *this; }
+    ~tracked() { --alive; }
+};
+long tracked::copies = 0, tracked::moves = 0, tracked::alive = 0;
+
+bool move_only() {
+    sjtu::deque<std::unique_ptr<int>> q;
+    std::deque<int> stl;
+    for (int i = 0; i < 30000; ++i) {
+        int v = int(rng() % 100000);
+        size_t p = rng() % (stl.size() + 1);
+        switch (rng() % 7) {
+        case 0: q.push_back(std::unique_ptr<int>(new int(v))), stl.push_back(v); break;
+        case 1: q.push_front(std::unique_ptr<int>(new int(v))), stl.push_front(v); break;
+        case 2: {
+            std::unique_ptr<int> x(new int(v));
+            auto it = q.insert(q.begin() + long(p), std::move(x));
+            stl.insert(stl.begin() + long(p), v);
+            if (x || **it != v || size_t(it - q.begin()) != p) return false;
+            break;
+        }
+        case 3:
+            if (*q.emplace_back(new int(v)) != v) return false;
+            stl.push_back(v);
+            break;
+        case 4:
+            if (*q.emplace_front(new int(v)) != v) return false;
+            stl.push_front(v);
+            break;
+        case 5:
+            if (!stl.empty()) {
+                p = rng() % stl.size();
+                q.erase(q.begin() + long(p));
+                stl.erase(stl.begin() + long(p));
+            }
+            break;
+        default:
+            if (!stl.empty()) {
+                if (rng() % 2) q.pop_back(), stl.pop_back();
+                else q.pop_front(), stl.pop_front();
+            }
+        }
+    }
+    if (q.size() != stl.size()) return false;
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (!q[i] || *q[i] != stl[i]) return false;
+    // The whole deque moves without touching the elements
+    sjtu::deque<std::unique_ptr<int>> moved(std::move(q));
+    return moved.size() == stl.size() && (stl.empty() || *moved[0] == stl[0]);
+}
+
+// Rvalue pushes and emplaces never copy an element
+bool no_copies() {
+    sjtu::deque<tracked> q;
+    std::deque<int> stl;
+    for (int i = 0; i < 20000; ++i) {
+        size_t p = rng() % (stl.size() + 1);
+        switch (rng() % 6) {
+        case 0: q.push_back(tracked(i, -i)), stl.push_back(i); break;
+        case 1: q.push_front(tracked(i, -i)), stl.push_front(i); break;
+        case 2:
+            q.insert(q.begin() + long(p), tracked(i, -i));
+            stl.insert(stl.begin() + long(p), i);
+            break;
+        case 3: q.emplace_back(i, -i), stl.push_back(i); break;
+        case 4: q.emplace_front(i, -i), stl.push_front(i); break;
+        default:
+            q.emplace(q.begin() + long(p), i, -i);
+            stl.insert(stl.begin() + long(p), i);
+        }
+    }
+    if (tracked::copies != 0 || q.size() != stl.size()) return false;
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i].a != stl[i] || q[i].b != -stl[i]) return false;
+
+    // Emplacing at the ends constructs in place, with no move either
+    long moves = tracked::moves;
+    for (int i = 0; i < 1000; ++i) q.emplace_back(i, i), q.emplace_front(i, i);
+    bool ok = tracked::moves == moves;
+    q.clear();
+    return ok && tracked::copies == 0 && tracked::alive == 0;
+}
+
+// emplace(pos, args...) returns an iterator to the new element at pos
+bool lands_at_pos() {
+    sjtu::deque<tracked> q;
+    std::deque<int> stl;
+    auto it = q.emplace(q.begin(), 1, 1);
+    if (it != q.begin() || it->a != 1) return false;
+    stl.push_back(1);
+    for (int i = 2; i < 5000; ++i) {
+        size_t p = i % 3 == 0 ? 0 : i % 3 == 1 ? stl.size() : rng() % (stl.size() + 1);
+        it = q.emplace(q.begin() + long(p), i, i * 2);
+        stl.insert(stl.begin() + long(p), i);
+        if (size_t(it - q.begin()) != p || it->a != i || it->b != i * 2 || q[p].a != i)
+            return false;
+    }
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i].a != stl[i]) return false;
+    return true;
+}
+
+int main() {
+    puts(move_only() ? "move only: ok" : "move only: FAIL");
+    puts(no_copies() ? "no copies: ok" : "no copies: FAIL");
+    puts(lands_at_pos() ? "emplace position: ok" : "emplace position: FAIL");
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include "deque.hpp"
+
+// append, prepend and split_at against std::deque, for deques with their
+// own node pools and for deques sharing the thread's pool.
+
+std::mt19937 rng(9);
+
+template <class Q>
+bool same(Q &q, const std::deque<std::string> &stl) {
+    if (q.size() != stl.size()) return false;
+    size_t i = 0;
+    for (auto it = q.begin(); it != q.end(); ++it, ++i)
+        if (*it != stl[i]) return false;
+    return i == stl.size();
+}
+
+template <class Make> bool run(Make make) {
+    auto q = make();
+    std::deque<std::string> stl;
+    for (int round = 0; round < 200; ++round) {
+        auto other = make();
+        std::deque<std::string> expect;
+        size_t n = rng() % 2000;
+        for (size_t i = 0; i < n; ++i) {
+            std::string s = std::to_string(round * 10000 + int(i));
+            other.push_back(s);
+            expect.push_back(s);
+        }
+        switch (rng() % 3) {
+        case 0:
+            q.append(std::move(other));
+            stl.insert(stl.end(), expect.begin(), expect.end());
+            if (!other.empty()) return false;
+            break;
+        case 1:
+            q.prepend(std::move(other));
+            stl.insert(stl.begin(), expect.begin(), expect.end());
+            if (!other.empty()) return false;
+            break;
+        default: {
+            size_t pos = rng() % (stl.size() + 1);
+            auto tail = q.split_at(q.begin() + pos);
+            std::deque<std::string> expect_tail(stl.begin() + pos, stl.end());
+            stl.erase(stl.begin() + pos, stl.end());
+            if (!same(tail, expect_tail)) return false;
+            // Both halves stay usable
+            tail.push_front("t");
+            q.push_back("q");
+            stl.push_back("q");
+            stl.push_back("t");
+            stl.insert(stl.end(), expect_tail.begin(), expect_tail.end());
+            q.append(std::move(tail));
+            if (!tail.empty()) return false;
+        }
+        }
+        if (!same(q, stl)) return false;
+    }
+    return true;
+}
+
+int main() {
+    bool own = run([] { return sjtu::deque<std::string>(); });
+    bool shared = run([] { return sjtu::deque<std::string>(sjtu::thread_pool); });
+    puts(own ? "own pool: ok" : "own pool: FAIL");
+    puts(shared ? "thread pool: ok" : "thread pool: FAIL");
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "deque.hpp"
+
+// memory_usage(), compact() and shrink_to_fit() on deques left sparse by
+// middle erases: the contents must match std::deque afterwards, and the
+// reported overhead must fall to what the packed layout needs.
+
+std::mt19937 rng(24);
+
+template <class T> bool same(sjtu::deque<T> &q, const std::deque<T> &stl) {
+    if (q.size() != stl.size()) return false;
+    size_t i = 0;
+    for (auto it = q.begin(); it != q.end(); ++it, ++i)
+        if (!(*it == stl[i])) return false;
+    for (i = 0; i < stl.size(); i += 13)
+        if (!(q[i] == stl[i])) return false;
+    return true;
+}
+
+template <class T> bool sane(const sjtu::deque<T> &q) {
+    sjtu::deque_memory m = q.memory_usage();
+    return m.container == sizeof(q) && m.payload == q.size() * sizeof(T) &&
+           m.total() == m.payload + m.overhead();
+}
+
+// Build a deque from both ends, then erase most of it from the middle so
+// many blocks are left underfilled
+template <class T, class Make>
+void sparse(sjtu::deque<T> &q, std::deque<T> &stl, size_t n, Make make) {
+    for (size_t i = 0; i < n; ++i) {
+        T v = make(i);
+        if (i % 2) q.push_back(v), stl.push_back(v);
+        else q.push_front(v), stl.push_front(v);
+    }
+    for (size_t i = 0; i < n * 3 / 4; ++i) {
+        size_t p = rng() % stl.size();
+        q.erase(q.begin() + long(p));
+        stl.erase(stl.begin() + long(p));
+    }
+}
+
+template <class T, class Make> bool check(size_t n, Make make) {
+    sjtu::deque<T> q;
+    std::deque<T> stl;
+    sparse(q, stl, n, make);
+    if (!sane(q)) return false;
+    size_t before = q.memory_usage().overhead();
+
+    // After compact every block but the last is full
+    q.compact();
+    if (!same(q, stl) || !sane(q)) return false;
+    sjtu::deque_stats s = q.stats();
+    size_t fill = s.max_block_size;
+    if (s.blocks != (stl.size() + fill - 1) / fill) return false;
+    sjtu::deque_memory m = q.memory_usage();
+    if (m.slack > (s.blocks + fill) * sizeof(T)) return false;
+    if (stl.size() > 4 * fill && m.overhead() >= before) return false;
+
+    // Compacting again changes nothing
+    q.compact();
+    if (!same(q, stl) || q.stats().blocks != s.blocks) return false;
+
+    // shrink_to_fit leaves one free slot per block and no spares or index
+    q.shrink_to_fit();
+    m = q.memory_usage();
+    if (m.spares != 0 || m.index != 0 || m.slack != q.stats().blocks * sizeof(T))
+        return false;
+    if (!same(q, stl) || !sane(q)) return false;
+
+    // The deque keeps working afterwards
+    for (size_t i = 0; i < n / 2; ++i) {
+        T v = make(i);
+        size_t p = rng() % (stl.size() + 1);
+        q.insert(q.begin() + long(p), v);
+        stl.insert(stl.begin() + long(p), v);
+        if (i % 3 == 0) q.pop_front(), stl.pop_front();
+    }
+    return same(q, stl) && sane(q);
+}
+
+// Element whose moves start throwing once a countdown runs out
+long moves_left = -1;
+struct fragile {
+    int v;
+    explicit fragile(int v) : v(v) {}
+    fragile(const fragile &o) : v(o.v) {}
+    fragile(fragile &&o) : v(o.v) {
+        if (moves_left == 0) throw std::runtime_error("move");
+        if (moves_left > 0) --moves_left;
+    }
+    fragile &operator=(const fragile &o) { v = o.v; return *this; }
+    bool operator==(const fragile &o) const { return v == o.v; }
+};
+
+// A move failing inside compact(), including the first one into a freshly
+// linked block, leaves the elements, their order and non-empty blocks
+bool throwing() {
+    // Moves k * fill are the first ones into a new block
+    const long fill = long(sjtu::sqrt_block_policy::max_size<fragile>(5000));
+    for (long fail : {0L, 1L, 17L, fill - 1, fill, fill + 1, 2 * fill, 3 * fill + 5, 9 * fill}) {
+        sjtu::deque<fragile> q;
+        std::deque<fragile> stl;
+        sparse(q, stl, 20000, [](size_t i) { return fragile(int(i)); });
+        if (long(q.stats().max_block_size) != fill) return false;
+        moves_left = fail;
+        bool threw = false;
+        try {
+            q.compact();
+        } catch (std::runtime_error &) {
+            threw = true;
+        }
+        moves_left = -1;
+        sjtu::deque_stats st = q.stats();
+        if (!threw || !same(q, stl) || st.smallest_block == 0) return false;
+        size_t total = 0;
+        for (auto seg : q.segments()) total += seg.size();
+        if (total != stl.size()) return false;
+        // The deque stays usable, and a later compact finishes the job
+        q.insert(q.begin() + long(stl.size() / 2), fragile(-1));
+        stl.insert(stl.begin() + long(stl.size() / 2), fragile(-1));
+        q.compact();
+        if (!same(q, stl) || q.stats().blocks != (stl.size() + size_t(fill) - 1) / size_t(fill))
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    sjtu::deque<int> empty;
+    empty.compact();
+    empty.shrink_to_fit();
+    sjtu::deque_memory m = empty.memory_usage();
+    bool ok = empty.empty() && m.payload == 0 && m.slack == 0 && m.spares == 0 &&
+              m.index == 0 && sane(empty);
+    empty.push_back(1);
+    ok = ok && empty.size() == 1 && empty[0] == 1;
+    puts(ok ? "empty: ok" : "empty: FAIL");
+
+    ok = check<int>(1, [](size_t i) { return int(i); }) &&
+         check<int>(20000, [](size_t) { return int(rng()); }) &&
+         check<int>(200000, [](size_t) { return int(rng()); });
+    puts(ok ? "int: ok" : "int: FAIL");
+
+    ok = check<std::string>(30000, [](size_t i) { return std::to_string(i * 7919); });
+    puts(ok ? "string: ok" : "string: FAIL");
+
+    // Blocks filled at the back were cut at smaller maximum sizes while the
+    // deque grew; compact repacks them at the current one
+    sjtu::deque<int> packed;
+    std::deque<int> stl;
+    for (int i = 0; i < 100000; ++i) packed.push_back(i), stl.push_back(i);
+    size_t blocks = packed.stats().blocks;
+    packed.compact();
+    sjtu::deque_stats after = packed.stats();
+    ok = same(packed, stl) && after.blocks <= blocks &&
+         after.blocks == (stl.size() + after.max_block_size - 1) / after.max_block_size;
+    puts(ok ? "packed: ok" : "packed: FAIL");
+    puts(throwing() ? "throwing move: ok" : "throwing move: FAIL");
+    return 0;
+}
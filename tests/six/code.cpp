@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "deque.hpp"
+
+// Bulk range construction, assign, append_range and range insert, checked
+// against std::deque. Input iterator ranges take the one-by-one path.
+
+std::mt19937 rng(8);
+
+template <class T>
+bool same(const sjtu::deque<T> &q, const std::deque<T> &stl) {
+    if (q.size() != stl.size()) return false;
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i] != stl[i]) return false;
+    return true;
+}
+
+bool construct_and_assign() {
+    std::vector<int> v(50000);
+    for (size_t i = 0; i < v.size(); ++i) v[i] = int(rng());
+    sjtu::deque<int> q(v.begin(), v.end());
+    std::deque<int> stl(v.begin(), v.end());
+    if (!same(q, stl)) return false;
+
+    sjtu::deque<int> r(1234, 7);
+    if (!same(r, std::deque<int>(1234, 7))) return false;
+
+    std::list<int> l(v.begin(), v.begin() + 777);
+    q.assign(l.begin(), l.end());
+    stl.assign(l.begin(), l.end());
+    if (!same(q, stl)) return false;
+    q.assign(size_t(30000), -1);
+    stl.assign(size_t(30000), -1);
+    if (!same(q, stl)) return false;
+    q.assign(v.begin(), v.begin());
+    return q.empty();
+}
+
+bool append() {
+    sjtu::deque<std::string> q;
+    std::deque<std::string> stl;
+    for (int round = 0; round < 20; ++round) {
+        std::vector<std::string> v(rng() % 3000);
+        for (auto &s : v) s = std::to_string(rng() % 1000);
+        q.append_range(v.begin(), v.end());
+        stl.insert(stl.end(), v.begin(), v.end());
+        q.push_front("front");
+        stl.push_front("front");
+    }
+    std::istringstream in("1 2 3 4 5 6 7 8 9 10");
+    sjtu::deque<int> a;
+    a.append_range(std::istream_iterator<int>(in), std::istream_iterator<int>());
+    return same(q, stl) && a.size() == 10 && a.back() == 10;
+}
+
+bool insert() {
+    sjtu::deque<int> q;
+    std::deque<int> stl;
+    for (int i = 0; i < 20000; ++i) q.push_back(i), stl.push_back(i);
+    for (int round = 0; round < 300; ++round) {
+        std::vector<int> v(rng() % (round % 3 == 0 ? 1000 : 8));
+        for (auto &x : v) x = int(rng());
+        size_t pos = rng() % (stl.size() + 1);
+        auto it = q.insert(q.begin() + pos, v.begin(), v.end());
+        stl.insert(stl.begin() + pos, v.begin(), v.end());
+        if (it - q.begin() != long(pos)) return false;
+    }
+    // Short ranges at the seam of two full blocks leave no underfull block
+    sjtu::deque<int> f;
+    for (int i = 0; i < 3000; ++i) f.push_back(i);
+    size_t block = f.stats().largest_block;
+    std::vector<int> few(5, 0);
+    for (size_t b = 1; b < 10; ++b)
+        f.insert(f.begin() + b * block + (b - 1) * few.size(), few.begin(),
+                 few.end());
+    return same(q, stl) && f.stats().small_blocks == 0;
+}
+
+int main() {
+    puts(construct_and_assign() ? "construct: ok" : "construct: FAIL");
+    puts(append() ? "append: ok" : "append: FAIL");
+    puts(insert() ? "insert: ok" : "insert: FAIL");
+    return 0;
+}
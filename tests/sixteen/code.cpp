@@ -0,0 +1,116 @@
+#define SJTU_DEQUE_STATS
+#include <cstdio>
+#include <deque>
+#include <random>
+#include "deque.hpp"
+
+// deque::stats() with the counters compiled in: the counters only grow, and
+// the structural fields agree with each other and with the contents, which are checked against
+// std::deque after every round of random operations.
+
+std::mt19937 rng(22);
+
+bool consistent(sjtu::deque<int> &q, const std::deque<int> &stl) {
+    if (q.size() != stl.size()) return false;
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i] != stl[i]) return false;
+    sjtu::deque_stats s = q.stats();
+    // Each block is one segment, or two when its ring wraps around
+    size_t segments = 0, elements = 0;
+    for (auto seg : q.segments()) ++segments, elements += seg.size();
+    size_t histogram = 0;
+    for (size_t b = 0; b < sjtu::deque_stats::fill_buckets; ++b)
+        histogram += s.fill_histogram[b];
+    return s.counting && s.size == stl.size() && elements == s.size &&
+           s.blocks <= segments && segments <= 2 * s.blocks && histogram == s.blocks &&
+           s.small_blocks <= s.blocks && s.smallest_block <= s.largest_block &&
+           s.smallest_block * s.blocks <= s.size && s.size <= s.largest_block * s.blocks &&
+           (s.small_blocks == 0) == (s.blocks == 0 || s.smallest_block >= s.min_block_size) &&
+           s.min_block_size <= s.max_block_size &&
+           s.node_allocations - s.node_frees >= s.blocks;
+}
+
+bool grown(const sjtu::deque_stats &a, const sjtu::deque_stats &b) {
+    return b.splits >= a.splits && b.merges >= a.merges &&
+           b.node_allocations >= a.node_allocations && b.node_frees >= a.node_frees &&
+           b.index_rebuilds >= a.index_rebuilds &&
+           b.index_rebuild_blocks >= a.index_rebuild_blocks && b.at_calls >= a.at_calls &&
+           b.at_blocks_visited >= a.at_blocks_visited && b.jump_calls >= a.jump_calls &&
+           b.jump_blocks_visited >= a.jump_blocks_visited;
+}
+
+int main() {
+    sjtu::deque<int> q;
+    std::deque<int> stl;
+    sjtu::deque_stats zero = q.stats();
+    bool ok = zero.counting && zero.size == 0 && zero.blocks == 0 && zero.splits == 0 &&
+              zero.merges == 0 && zero.at_calls == 0 && zero.at_blocks_per_call() == 0;
+    puts(ok ? "empty: ok" : "empty: FAIL");
+
+    ok = true;
+    sjtu::deque_stats last = zero;
+    for (int round = 0; round < 60 && ok; ++round) {
+        for (int i = 0; i < 2000; ++i) {
+            int v = int(rng() % 100000);
+            switch (rng() % 6) {
+            case 0: q.push_back(v), stl.push_back(v); break;
+            case 1: q.push_front(v), stl.push_front(v); break;
+            case 2: {
+                size_t p = stl.empty() ? 0 : rng() % (stl.size() + 1);
+                q.insert(q.begin() + long(p), v);
+                stl.insert(stl.begin() + long(p), v);
+                break;
+            }
+            case 3:
+                if (!stl.empty()) {
+                    size_t p = rng() % stl.size();
+                    q.erase(q.begin() + long(p));
+                    stl.erase(stl.begin() + long(p));
+                }
+                break;
+            case 4:
+                if (!stl.empty()) q.pop_back(), stl.pop_back();
+                break;
+            default:
+                if (!stl.empty()) q.pop_front(), stl.pop_front();
+            }
+        }
+        ok = consistent(q, stl);
+        sjtu::deque_stats now = q.stats();
+        ok = ok && grown(last, now);
+        last = now;
+    }
+    puts(ok ? "structure: ok" : "structure: FAIL");
+
+    // Middle inserts split blocks and middle erases merge them back
+    ok = last.splits > 0 && last.merges > 0 && last.node_allocations > 0 &&
+         last.node_frees > 0 && last.index_rebuilds > 0;
+    puts(ok ? "counters: ok" : "counters: FAIL");
+
+    // Lookups are counted along with the index entries they probe; jumps
+    // that stay inside the starting block skip the index and are not
+    sjtu::deque_stats before = q.stats();
+    long sum = 0;
+    for (size_t i = 0; i < stl.size(); i += 7) sum += q[i];
+    auto first = q.begin();
+    for (size_t i = 0; i < stl.size(); i += 11) sum -= *(first + long(i));
+    sjtu::deque_stats after = q.stats();
+    long expect = 0;
+    for (size_t i = 0; i < stl.size(); i += 7) expect += stl[i];
+    for (size_t i = 0; i < stl.size(); i += 11) expect -= stl[i];
+    ok = sum == expect &&
+         after.at_calls - before.at_calls == (stl.size() + 6) / 7 &&
+         after.jump_calls > before.jump_calls &&
+         after.jump_calls - before.jump_calls <= (stl.size() + 10) / 11 &&
+         after.at_blocks_visited >= before.at_blocks_visited &&
+         after.at_blocks_per_call() >= 0;
+    puts(ok ? "lookups: ok" : "lookups: FAIL");
+
+    // Clearing keeps the counters
+    q.clear();
+    stl.clear();
+    sjtu::deque_stats cleared = q.stats();
+    ok = consistent(q, stl) && cleared.blocks == 0 && grown(after, cleared);
+    puts(ok ? "clear: ok" : "clear: FAIL");
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+#include "deque.hpp"
+#include "deque_algorithm.hpp"
+
+// Segments must cover the elements in order with no gaps, including blocks
+// whose ring buffer wraps, and the segmented algorithms must agree with
+// std::deque.
+
+std::mt19937 rng(15);
+
+void build(sjtu::deque<int> &q, std::deque<int> &stl) {
+    for (int i = 0; i < 60000; ++i) {
+        int v = int(rng() % 1000);
+        switch (rng() % 4) {
+        case 0: q.push_front(v); stl.push_front(v); break;
+        case 1: q.push_back(v); stl.push_back(v); break;
+        case 2:
+            if (!stl.empty()) { q.pop_front(); stl.pop_front(); }
+            break;
+        default: {
+            size_t pos = rng() % (stl.size() + 1);
+            q.insert(q.begin() + pos, v);
+            stl.insert(stl.begin() + pos, v);
+        }
+        }
+    }
+}
+
+bool segments(sjtu::deque<int> &q, const std::deque<int> &stl) {
+    size_t i = 0;
+    for (auto seg : q.segments()) {
+        if (seg.size() == 0) return false;
+        for (int *p = seg.begin(); p != seg.end(); ++p, ++i)
+            if (i >= stl.size() || *p != stl[i]) return false;
+    }
+    const sjtu::deque<int> &c = q;
+    size_t j = 0;
+    for (auto seg : c.segments()) j += seg.size();
+    size_t k = 0;
+    c.for_each_segment([&](const int *first, const int *last) { k += last - first; });
+    return i == stl.size() && j == i && k == i;
+}
+
+bool algorithms(sjtu::deque<int> &q, std::deque<int> &stl) {
+    long sum = 0;
+    sjtu::for_each(q, [&](int &x) { x += 1; });
+    for (int &x : stl) x += 1;
+    sjtu::for_each(static_cast<const sjtu::deque<int> &>(q), [&](const int &x) { sum += x; });
+    long expect = 0;
+    for (int x : stl) expect += x;
+    if (sum != expect || sjtu::accumulate(q, 0L) != expect) return false;
+    if (sjtu::accumulate(q, 0L, [](long a, int x) { return a + 2 * x; }) != 2 * expect)
+        return false;
+
+    std::vector<int> out(stl.size());
+    if (sjtu::copy(q, out.begin()) != out.end()) return false;
+    for (size_t i = 0; i < out.size(); ++i)
+        if (out[i] != stl[i]) return false;
+
+    for (int v : {0, 500, 1000, 2000}) {
+        auto it = sjtu::find(q, v);
+        size_t pos = 0;
+        while (pos < stl.size() && stl[pos] != v) ++pos;
+        if (it - q.begin() != long(pos)) return false;
+        auto cit = sjtu::find(static_cast<const sjtu::deque<int> &>(q), v);
+        if (cit - q.cbegin() != long(pos)) return false;
+    }
+
+    sjtu::fill(q, q[q.size() / 2]);
+    int v = stl[stl.size() / 2];
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i] != v) return false;
+    return true;
+}
+
+int main() {
+    sjtu::deque<int> q;
+    std::deque<int> stl;
+    build(q, stl);
+    puts(segments(q, stl) ? "segments: ok" : "segments: FAIL");
+    puts(algorithms(q, stl) ? "algorithms: ok" : "algorithms: FAIL");
+    sjtu::deque<int> empty;
+    puts(empty.segments().begin() == empty.segments().end() ? "empty: ok" : "empty: FAIL");
+    return 0;
+}
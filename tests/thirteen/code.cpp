@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "concurrent_deque.hpp"
+
+// concurrent_deque on one thread must behave like std::deque at both ends;
+// with producers and consumers on both ends, every value must come out
+// exactly once.
+
+std::mt19937 rng(19);
+
+bool single_thread() {
+    sjtu::concurrent_deque<std::string> q;
+    std::deque<std::string> stl;
+    std::string x;
+    for (int i = 0; i < 200000; ++i) {
+        std::string v = std::to_string(i);
+        switch (rng() % 4) {
+        case 0: q.push_back(v); stl.push_back(v); break;
+        case 1: q.push_front(v); stl.push_front(v); break;
+        case 2:
+            if (q.try_pop_front(x) != !stl.empty()) return false;
+            if (!stl.empty()) {
+                if (x != stl.front()) return false;
+                stl.pop_front();
+            }
+            break;
+        default:
+            if (q.try_pop_back(x) != !stl.empty()) return false;
+            if (!stl.empty()) {
+                if (x != stl.back()) return false;
+                stl.pop_back();
+            }
+        }
+        if (q.size() != stl.size() || q.empty() != stl.empty()) return false;
+    }
+    while (!stl.empty()) {
+        if (!q.try_pop_front(x) || x != stl.front()) return false;
+        stl.pop_front();
+    }
+    return !q.try_pop_back(x) && q.empty();
+}
+
+bool many_threads() {
+    const int PRODUCERS = 4, CONSUMERS = 4, N = 100000;
+    sjtu::concurrent_deque<long> q;
+    std::vector<std::atomic<int>> seen(PRODUCERS * N);
+    for (auto &s : seen) s.store(0);
+    std::atomic<int> producing(PRODUCERS);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < PRODUCERS; ++p)
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < N; ++i) {
+                long v = long(p) * N + i;
+                if (i % 2) q.push_back(v);
+                else q.push_front(v);
+            }
+            producing.fetch_sub(1);
+        });
+    for (int c = 0; c < CONSUMERS; ++c)
+        threads.emplace_back([&, c] {
+            long v;
+            for (;;) {
+                bool finished = producing.load() == 0;
+                bool got = c % 2 ? q.try_pop_back(v) : q.try_pop_front(v);
+                if (got) seen[v].fetch_add(1);
+                else if (finished) return;
+            }
+        });
+    for (auto &t : threads) t.join();
+    for (auto &s : seen)
+        if (s.load() != 1) return false;
+    return q.empty();
+}
+
+int main() {
+    puts(single_thread() ? "single thread: ok" : "single thread: FAIL");
+    puts(many_threads() ? "many threads: ok" : "many threads: FAIL");
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+#include "deque.hpp"
+#include "deque_sort.hpp"
+
+// sort and stable_sort against std::sort and std::stable_sort, at sizes
+// that take the single-chunk path and the multiway merge. Stability is
+// checked with records that share keys.
+
+std::mt19937 rng(17);
+
+struct record {
+    int key;
+    int seq;
+};
+
+bool by_key(const record &a, const record &b) { return a.key < b.key; }
+
+bool sort_ints(sjtu::work_stealing_pool &pool) {
+    for (size_t n : {size_t(0), size_t(1), size_t(1000), size_t(200000)}) {
+        sjtu::deque<int> q;
+        std::deque<int> stl;
+        for (size_t i = 0; i < n; ++i) {
+            int v = int(rng() % 5000) - 2500;
+            if (i % 2) q.push_back(v), stl.push_back(v);
+            else q.push_front(v), stl.push_front(v);
+        }
+        sjtu::deque<int> r(q);
+        sjtu::sort(pool, q);
+        std::sort(stl.begin(), stl.end());
+        sjtu::sort(pool, r, std::greater<int>());
+        if (q.size() != n || r.size() != n) return false;
+        for (size_t i = 0; i < n; ++i)
+            if (q[i] != stl[i] || r[i] != stl[n - 1 - i]) return false;
+    }
+    return true;
+}
+
+bool stable(sjtu::work_stealing_pool &pool) {
+    for (size_t n : {size_t(3000), size_t(150000)}) {
+        sjtu::deque<record> q;
+        std::deque<record> stl;
+        for (size_t i = 0; i < n; ++i) {
+            record r{int(rng() % 100), int(i)};
+            q.push_back(r);
+            stl.push_back(r);
+        }
+        sjtu::stable_sort(pool, q, by_key);
+        std::stable_sort(stl.begin(), stl.end(), by_key);
+        for (size_t i = 0; i < n; ++i)
+            if (q[i].key != stl[i].key || q[i].seq != stl[i].seq) return false;
+    }
+    return true;
+}
+
+bool strings() {
+    sjtu::deque<std::string> q;
+    std::deque<std::string> stl;
+    for (int i = 0; i < 40000; ++i) {
+        std::string s = std::to_string(rng());
+        q.push_back(s);
+        stl.push_back(s);
+    }
+    sjtu::sort(q);
+    std::sort(stl.begin(), stl.end());
+    for (size_t i = 0; i < stl.size(); ++i)
+        if (q[i] != stl[i]) return false;
+    return true;
+}
+
+int main() {
+    sjtu::work_stealing_pool pool(4);
+    puts(sort_ints(pool) ? "sort: ok" : "sort: FAIL");
+    puts(stable(pool) ? "stable_sort: ok" : "stable_sort: FAIL");
+    puts(strings() ? "strings: ok" : "strings: FAIL");
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include "deque.hpp"
+
+// Deques on a stateful allocator. Each arena records the blocks it handed
+// out, so memory returned to the wrong arena, or never returned, shows up.
+// Copies, move assignment, append, prepend and split_at between deques whose
+// allocators compare unequal are checked against std::deque.
+
+std::mt19937 rng(7);
+
+struct arena {
+    std::map<void *, size_t> live; // Allocated block -> bytes
+    long allocations = 0;
+    bool wrong_free = false;
+};
+
+template <class T> struct arena_allocator {
+    typedef T value_type;
+    arena *a;
+    explicit arena_allocator(arena *a) : a(a) {}
+    template <class U> arena_allocator(const arena_allocator<U> &o) : a(o.a) {}
+
+    T *allocate(size_t n) {
+        void *p = std::malloc(n * sizeof(T));
+        if (!p) throw std::bad_alloc();
+        a->live[p] = n * sizeof(T);
+        ++a->allocations;
+        return static_cast<T *>(p);
+    }
+    void deallocate(T *p, size_t n) {
+        auto it = a->live.find(p);
+        if (it == a->live.end() || it->second != n * sizeof(T)) a->wrong_free = true;
+        else a->live.erase(it);
+        std::free(p);
+    }
+
+    // Copies of a deque draw from the copy arena, to show this is honoured
+    static arena copies;
+    arena_allocator select_on_container_copy_construction() const {
+        return arena_allocator(&copies);
+    }
+};
+template <class T> arena arena_allocator<T>::copies;
+
+template <class T, class U>
+bool operator==(const arena_allocator<T> &x, const arena_allocator<U> &y) { return x.a == y.a; }
+template <class T, class U>
+bool operator!=(const arena_allocator<T> &x, const arena_allocator<U> &y) { return x.a != y.a; }
+
+typedef sjtu::deque<std::string, arena_allocator<std::string>> sdeque;
+arena &copy_arena = arena_allocator<std::string>::copies;
+
+bool same(sdeque &q, const std::deque<std::string> &stl) {
+    if (q.size() != stl.size()) return false;
+    size_t i = 0;
+    for (auto it = q.begin(); it != q.end(); ++it, ++i)
+        if (*it != stl[i]) return false;
+    for (i = 0; i < stl.size(); i += 17)
+        if (q[i] != stl[i]) return false;
+    return true;
+}
+
+void fill(sdeque &q, std::deque<std::string> &stl, int n) {
+    for (int i = 0; i < n; ++i) {
+        std::string v = std::to_string(rng()) + std::string(i % 40, 'x');
+        size_t p = rng() % (stl.size() + 1);
+        switch (rng() % 3) {
+        case 0: q.push_back(v), stl.push_back(v); break;
+        case 1: q.push_front(v), stl.push_front(v); break;
+        default:
+            q.insert(q.begin() + long(p), v);
+            stl.insert(stl.begin() + long(p), v);
+        }
+    }
+}
+
+bool clean(const arena &a) { return a.live.empty() && !a.wrong_free; }
+
+int main() {
+    arena one, two;
+    bool ok = true;
+    {
+        sdeque a{arena_allocator<std::string>(&one)};
+        std::deque<std::string> sa;
+        fill(a, sa, 20000);
+        ok = same(a, sa) && one.allocations > 0 && two.allocations == 0;
+
+        sdeque c(a);
+        ok = ok && same(c, sa) && c.get_allocator().a == &copy_arena &&
+             copy_arena.allocations > 0;
+        c.push_front("front");
+        sa.push_front("front");
+        ok = ok && same(c, sa);
+        sa.pop_front();
+        // Copy assignment keeps the target's allocator
+        sdeque d{arena_allocator<std::string>(&two)};
+        d = a;
+        ok = ok && same(d, sa) && d.get_allocator().a == &two;
+    }
+    ok = ok && clean(one) && clean(two) && clean(copy_arena);
+    puts(ok ? "copy: ok" : "copy: FAIL");
+
+    {
+        sdeque a{arena_allocator<std::string>(&one)};
+        sdeque b{arena_allocator<std::string>(&two)};
+        std::deque<std::string> sa, sb;
+        fill(a, sa, 10000);
+        fill(b, sb, 10000);
+        // Emptied blocks are kept as spares; they must follow the allocator
+        for (int i = 0; i < 3000; ++i) a.pop_back(), sa.pop_back(), b.pop_front(), sb.pop_front();
+        a = std::move(b);
+        sa = sb;
+        // Nothing from a's old allocator is left behind in a
+        ok = same(a, sa) && a.get_allocator().a == &two && clean(one);
+        fill(a, sa, 5000);
+        ok = ok && same(a, sa);
+        b = std::move(a);
+        ok = ok && same(b, sa);
+        // The moved-from deque is empty and usable
+        std::deque<std::string> fresh;
+        fill(a, fresh, 100);
+        ok = ok && same(a, fresh);
+    }
+    ok = ok && clean(one) && clean(two);
+    puts(ok ? "move assign: ok" : "move assign: FAIL");
+
+    {
+        sdeque a{arena_allocator<std::string>(&one)};
+        std::deque<std::string> sa;
+        fill(a, sa, 8000);
+        for (int round = 0; round < 6 && ok; ++round) {
+            sdeque b{arena_allocator<std::string>(&two)};
+            std::deque<std::string> sb;
+            fill(b, sb, 3000);
+            if (round % 2) {
+                a.append(std::move(b));
+                sa.insert(sa.end(), sb.begin(), sb.end());
+            } else {
+                a.prepend(std::move(b));
+                sa.insert(sa.begin(), sb.begin(), sb.end());
+            }
+            ok = b.empty() && same(a, sa);
+            size_t p = rng() % (sa.size() + 1);
+            sdeque tail = a.split_at(a.begin() + long(p));
+            std::deque<std::string> stail(sa.begin() + long(p), sa.end());
+            sa.erase(sa.begin() + long(p), sa.end());
+            ok = ok && same(a, sa) && same(tail, stail);
+            a.append(std::move(tail));
+            sa.insert(sa.end(), stail.begin(), stail.end());
+            ok = ok && same(a, sa);
+            a.erase(a.begin(), a.begin() + long(sa.size() / 3));
+            sa.erase(sa.begin(), sa.begin() + long(sa.size() / 3));
+            ok = ok && same(a, sa);
+        }
+        a.shrink_to_fit();
+        ok = ok && same(a, sa);
+    }
+    ok = ok && clean(one) && clean(two);
+    puts(ok ? "append: ok" : "append: FAIL");
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "deque.hpp"
+
+// The constant block policies against std::deque, including block sizes so
+// small that a block holds a single element. Every block must stay within
+// the policy's maximum through splits, merges and range operations.
+
+std::mt19937 rng(11);
+
+struct wide {
+    long words[16]; // 128 bytes, larger than a cache line
+    wide(long v = 0) { words[0] = v, words[15] = -v; }
+    bool operator==(const wide &rhs) const {
+        return words[0] == rhs.words[0] && words[15] == rhs.words[15];
+    }
+};
+
+template <class T> T make(long v) { return T(v); }
+template <> std::string make<std::string>(long v) { return std::to_string(v); }
+
+template <class D, class S> bool same(D &q, const S &stl) {
+    if (q.size() != stl.size()) return false;
+    size_t i = 0;
+    for (auto it = q.begin(); it != q.end(); ++it, ++i)
+        if (!(*it == stl[i])) return false;
+    for (i = 0; i < stl.size(); i += 1 + i % 7)
+        if (!(q[i] == stl[i])) return false;
+    sjtu::deque_stats s = q.stats();
+    return s.largest_block <= s.max_block_size && (s.blocks == 0 || s.smallest_block > 0);
+}
+
+template <class T, class Policy> bool run(size_t steps) {
+    typedef sjtu::deque<T, std::allocator<T>, Policy> deque_type;
+    deque_type q;
+    std::deque<T> stl;
+    for (size_t step = 0; step < steps; ++step) {
+        long v = long(rng() % 100000);
+        size_t n = stl.size();
+        size_t p = rng() % (n + 1);
+        switch (rng() % 12) {
+        case 0: case 1: q.push_back(make<T>(v)), stl.push_back(make<T>(v)); break;
+        case 2: case 3: q.push_front(make<T>(v)), stl.push_front(make<T>(v)); break;
+        case 4:
+            q.insert(q.begin() + long(p), make<T>(v));
+            stl.insert(stl.begin() + long(p), make<T>(v));
+            break;
+        case 5:
+            if (n) {
+                p = rng() % n;
+                q.erase(q.begin() + long(p));
+                stl.erase(stl.begin() + long(p));
+            }
+            break;
+        case 6:
+            if (n) {
+                if (rng() % 2) q.pop_back(), stl.pop_back();
+                else q.pop_front(), stl.pop_front();
+            }
+            break;
+        case 7: {
+            // Non-empty: libstdc++ 12 std::deque empties elements on an
+            // empty range insert in its back half
+            std::vector<T> range(1 + rng() % 40, make<T>(v));
+            q.insert(q.begin() + long(p), range.begin(), range.end());
+            q.insert(q.begin() + long(rng() % (n + 1)), range.end(), range.end());
+            stl.insert(stl.begin() + long(p), range.begin(), range.end());
+            break;
+        }
+        case 8:
+            if (n) {
+                size_t a = rng() % n, b = a + rng() % std::min<size_t>(n - a, 50);
+                q.erase(q.begin() + long(a), q.begin() + long(b));
+                stl.erase(stl.begin() + long(a), stl.begin() + long(b));
+            }
+            break;
+        case 9: {
+            deque_type tail = q.split_at(q.begin() + long(p));
+            if (rng() % 2) {
+                q.append(std::move(tail));
+            } else {
+                tail.append(std::move(q));
+                q = std::move(tail);
+                std::rotate(stl.begin(), stl.begin() + long(p), stl.end());
+            }
+            break;
+        }
+        case 10: {
+            size_t k = n ? rng() % std::min<size_t>(n, 30) : 0;
+            q.erase_back(k);
+            stl.erase(stl.end() - long(k), stl.end());
+            break;
+        }
+        default:
+            if (rng() % 8 == 0) q.compact();
+            else if (rng() % 8 == 0) q = deque_type(q);
+        }
+        if (step % 97 == 0 && !same(q, stl)) return false;
+    }
+    return same(q, stl);
+}
+
+int main() {
+    // One int per block, then two and four
+    bool ok = run<int, sjtu::fixed_bytes_block_policy<1>>(6000) &&
+              run<int, sjtu::fixed_bytes_block_policy<sizeof(int)>>(6000) &&
+              run<int, sjtu::fixed_bytes_block_policy<2 * sizeof(int)>>(6000) &&
+              run<int, sjtu::fixed_bytes_block_policy<4 * sizeof(int)>>(6000) &&
+              run<wide, sjtu::fixed_bytes_block_policy<64>>(4000);
+    puts(ok ? "tiny bytes: ok" : "tiny bytes: FAIL");
+    ok = run<int, sjtu::page_block_policy>(40000) &&
+         run<std::string, sjtu::page_block_policy>(20000) &&
+         run<wide, sjtu::page_block_policy>(20000);
+    puts(ok ? "page: ok" : "page: FAIL");
+    ok = run<int, sjtu::cache_line_block_policy<>>(40000) &&
+         run<int, sjtu::cache_line_block_policy<1, 4>>(6000) &&
+         run<int, sjtu::cache_line_block_policy<2, 8>>(6000) &&
+         run<wide, sjtu::cache_line_block_policy<3>>(20000);
+    puts(ok ? "cache line: ok" : "cache line: FAIL");
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <new>
+#include "deque.hpp"
+
+// Spare block storage, counted through the allocator: pushes covered by
+// reserve_back/reserve_front allocate nothing, a FIFO queue settles at zero
+// allocations, and set_spare_block_limit(0) and shrink_to_fit() give the
+// spares back. Contents are checked against std::deque throughout.
+
+long allocations = 0, live = 0;
+
+template <class T> struct counting_allocator {
+    typedef T value_type;
+    counting_allocator() {}
+    template <class U> counting_allocator(const counting_allocator<U> &) {}
+    T *allocate(size_t n) {
+        ++allocations, ++live;
+        if (n > size_t(-1) / sizeof(T)) throw std::bad_alloc();
+        if (void *p = std::malloc(n * sizeof(T))) return static_cast<T *>(p);
+        throw std::bad_alloc();
+    }
+    void deallocate(T *p, size_t) {
+        --live;
+        std::free(p);
+    }
+};
+template <class T, class U>
+bool operator==(const counting_allocator<T> &, const counting_allocator<U> &) { return true; }
+template <class T, class U>
+bool operator!=(const counting_allocator<T> &, const counting_allocator<U> &) { return false; }
+
+typedef sjtu::deque<int, counting_allocator<int>> cdeque;
+
+bool same(cdeque &q, const std::deque<int> &stl) {
+    if (q.size() != stl.size()) return false;
+    size_t i = 0;
+    for (auto it = q.begin(); it != q.end(); ++it, ++i)
+        if (*it != stl[i]) return false;
+    return true;
+}
+
+bool reserved() {
+    bool ok = true;
+    const size_t sizes[] = {1, 199, 200, 201, 5000, 100000};
+    for (size_t n : sizes) {
+        for (size_t start : {size_t(0), size_t(1), size_t(150), size_t(30000)}) {
+            cdeque q;
+            std::deque<int> stl;
+            for (size_t i = 0; i < start; ++i) q.push_back(int(i)), stl.push_back(int(i));
+            q.reserve_back(n);
+            long before = allocations;
+            for (size_t i = 0; i < n; ++i) q.push_back(-int(i)), stl.push_back(-int(i));
+            ok = ok && allocations == before && same(q, stl);
+
+            q.reserve_front(n);
+            before = allocations;
+            for (size_t i = 0; i < n; ++i) q.push_front(int(i)), stl.push_front(int(i));
+            ok = ok && allocations == before && same(q, stl);
+        }
+    }
+    return ok && live == 0;
+}
+
+bool fifo() {
+    cdeque q;
+    std::deque<int> stl;
+    for (int i = 0; i < 10000; ++i) q.push_back(i), stl.push_back(i);
+    long before = 0;
+    bool ok = true;
+    for (int round = 0; round < 20; ++round) {
+        if (round == 2) before = allocations; // Warmed up
+        for (int i = 0; i < 10000; ++i) {
+            q.push_back(i), stl.push_back(i);
+            q.pop_front(), stl.pop_front();
+        }
+        ok = ok && same(q, stl);
+    }
+    ok = ok && allocations == before;
+
+    // Draining and refilling the back reuses its spare too, once the back
+    // stack has storage for one
+    for (int round = 0; round < 5; ++round) {
+        if (round == 1) before = allocations;
+        for (int i = 0; i < 250; ++i) q.pop_back(), stl.pop_back();
+        for (int i = 0; i < 250; ++i) q.push_back(i), stl.push_back(i);
+    }
+    return ok && allocations == before && same(q, stl);
+}
+
+bool released() {
+    cdeque q;
+    std::deque<int> stl;
+    for (int i = 0; i < 50000; ++i) q.push_back(i), stl.push_back(i);
+    q.reserve_back(20000);
+    q.reserve_front(20000);
+    q.set_spare_block_limit(4);
+    for (int i = 0; i < 2000; ++i) q.pop_back(), stl.pop_back();
+    long kept = live;
+
+    // A limit of zero frees the spares, and emptied blocks from then on
+    q.set_spare_block_limit(0);
+    bool ok = live < kept && q.spare_block_limit() == 0 && same(q, stl);
+    long before = allocations;
+    for (int i = 0; i < 1000; ++i) q.pop_back(), stl.pop_back();
+    ok = ok && allocations == before && same(q, stl);
+    kept = live;
+    for (int i = 0; i < 1000; ++i) q.push_back(i), stl.push_back(i);
+    for (int i = 0; i < 1000; ++i) q.pop_back(), stl.pop_back();
+    ok = ok && live == kept && allocations > before && same(q, stl);
+
+    // shrink_to_fit releases the spares and the stacks holding them
+    q.set_spare_block_limit(8);
+    q.reserve_back(30000);
+    kept = live;
+    q.shrink_to_fit();
+    ok = ok && live < kept && q.memory_usage().spares == 0 && same(q, stl);
+    for (int i = 0; i < 5000; ++i) q.push_front(i), stl.push_front(i);
+    ok = ok && same(q, stl);
+    q.clear();
+    return ok && live > 0 && q.memory_usage().spares == 0;
+}
+
+int main() {
+    puts(reserved() ? "reserve: ok" : "reserve: FAIL");
+    puts(fifo() ? "fifo: ok" : "fifo: FAIL");
+    bool ok = released();
+    puts(ok && live == 0 ? "release: ok" : "release: FAIL");
+    return 0;
+}
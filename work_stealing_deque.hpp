@@ -0,0 +1,178 @@
+#ifndef SJTU_WORK_STEALING_DEQUE_HPP
+#define SJTU_WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace sjtu {
+
+/**
+ * Lock-free work-stealing deque after Chase and Lev, "Dynamic Circular
+ * Work-Stealing Deque" (2005), with the C11 memory orders of Le et al.,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models" (2013).
+ *
+ * A single owner thread pushes and pops at the bottom without locks or
+ * read-modify-write operations, except when it takes the last element.
+ * Any number of thieves steal from the top, and a CAS on top settles races
+ * between thieves and with the owner's last pop.
+ *
+ * Elements live in a ring block of 2^k slots indexed by the ever-growing
+ * top and bottom counters. A push into a full ring copies the live elements
+ * into a new ring twice as large. The old ring stays linked behind the new
+ * one, because a thief may still be reading it, and the whole chain is
+ * freed with the deque. Memory therefore stays below twice the peak ring.
+ *
+ * Unlike sjtu::deque, growth does not link fixed-size blocks. A chunked
+ * layout would need a chunk directory that thieves read while the owner
+ * extends it, so every access would go through two dependent loads and
+ * retired chunks would still have to outlive racing thieves. The doubling
+ * ring keeps one indirection per access at the cost of an O(n) copy per
+ * doubling, amortized O(1) per push.
+ *
+ * T must be trivially copyable and lock-free as a std::atomic, such as a
+ * pointer or an index. Larger tasks are pushed by pointer.
+ */
+template <class T> class work_stealing_deque {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "work_stealing_deque needs a trivially copyable T");
+  static_assert(std::atomic<T>::is_always_lock_free,
+                "work_stealing_deque needs a T that is lock-free as an atomic");
+
+private:
+  struct ring {
+    std::int64_t mask; // Capacity - 1, capacity a power of two
+    std::atomic<T> *slots;
+    ring *previous; // Ring this one replaced
+
+    ring(std::int64_t capacity, ring *prev)
+        : mask(capacity - 1), slots(new std::atomic<T>[capacity]),
+          previous(prev) {}
+    ~ring() { delete[] slots; }
+
+    std::int64_t capacity() const { return mask + 1; }
+    T load(std::int64_t i) const {
+      return slots[i & mask].load(std::memory_order_relaxed);
+    }
+    void store(std::int64_t i, T x) {
+      slots[i & mask].store(x, std::memory_order_relaxed);
+    }
+  };
+
+  // top and bottom on separate cache lines, so thieves hammering top do not
+  // slow the owner's bottom updates
+  alignas(64) std::atomic<std::int64_t> top;
+  alignas(64) std::atomic<std::int64_t> bottom;
+  std::atomic<ring *> array;
+
+  // Owner only: move [t, b) into a ring twice as large
+  ring *grow(ring *old, std::int64_t t, std::int64_t b) {
+    ring *bigger = new ring(old->capacity() * 2, old);
+    for (std::int64_t i = t; i < b; ++i)
+      bigger->store(i, old->load(i));
+    array.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+public:
+  /**
+   * @param capacity Initial number of slots, rounded up to a power of two
+   */
+  explicit work_stealing_deque(size_t capacity = 64) : top(0), bottom(0) {
+    std::int64_t cap = 1;
+    while (size_t(cap) < capacity)
+      cap *= 2;
+    array.store(new ring(cap, nullptr), std::memory_order_relaxed);
+  }
+
+  work_stealing_deque(const work_stealing_deque &) = delete;
+  work_stealing_deque &operator=(const work_stealing_deque &) = delete;
+
+  ~work_stealing_deque() {
+    ring *r = array.load(std::memory_order_relaxed);
+    while (r) {
+      ring *previous = r->previous;
+      delete r;
+      r = previous;
+    }
+  }
+
+  /**
+   * Add x at the bottom. Owner thread only.
+   * @throw std::bad_alloc if the ring must grow and allocation fails
+   */
+  void push(T x) {
+    std::int64_t b = bottom.load(std::memory_order_relaxed);
+    std::int64_t t = top.load(std::memory_order_acquire);
+    ring *a = array.load(std::memory_order_relaxed);
+    if (b - t > a->mask)
+      a = grow(a, t, b);
+    a->store(b, x);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Take the element at the bottom, the most recently pushed one. Owner
+   * thread only.
+   * @return false if the deque was empty or a thief took the last element
+   */
+  bool pop(T &out) {
+    std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    ring *a = array.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = top.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+    out = a->load(b);
+    if (t < b)
+      return true;
+    // Last element: race the thieves for it
+    bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return won;
+  }
+
+  /**
+   * Take the element at the top, the oldest one. Any thread.
+   * @return false if the deque was empty or another thread took the element
+   * first; callers retry or move on to another victim
+   */
+  bool steal(T &out) {
+    std::int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+      return false;
+    ring *a = array.load(std::memory_order_acquire);
+    T x = a->load(t);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      return false;
+    out = x;
+    return true;
+  }
+
+  // Number of elements; exact only while no other thread is operating
+  size_t size() const {
+    std::int64_t b = bottom.load(std::memory_order_relaxed);
+    std::int64_t t = top.load(std::memory_order_relaxed);
+    return b > t ? size_t(b - t) : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  // Slots in the current ring
+  size_t capacity() const {
+    return size_t(array.load(std::memory_order_relaxed)->capacity());
+  }
+};
+
+} // namespace sjtu
+
+#endif
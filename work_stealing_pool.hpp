@@ -0,0 +1,271 @@
+#ifndef SJTU_WORK_STEALING_POOL_HPP
+#define SJTU_WORK_STEALING_POOL_HPP
+
+#include "deque.hpp"
+#include "work_stealing_deque.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace sjtu {
+
+/**
+ * Small fork-join thread pool with work stealing.
+ *
+ * parallel_for(n, grain, body) runs body(lo, hi) over [0, n) split into
+ * ranges of at most grain indices. A task covering more than grain indices
+ * pushes its upper half onto the running thread's queue and keeps the lower
+ * half, so every queue holds large ranges at the front and small ones at the
+ * back. Owners pop from the back, idle threads steal from the front of a
+ * random victim, which hands thieves the largest available pieces.
+ *
+ * Every worker owns a lock-free work_stealing_deque, so pushes, pops and
+ * steals on worker queues take no lock. Threads outside the pool share one
+ * mutex-guarded queue, since a work_stealing_deque has a single owner.
+ *
+ * The calling thread takes part in the work and returns once every index has
+ * run. Calls may be nested inside a body and may come from several threads
+ * at once. The first exception thrown by a body is rethrown to the caller
+ * after all indices have finished.
+ */
+class work_stealing_pool {
+private:
+  struct job {
+    void (*invoke)(const void *body, size_t lo, size_t hi);
+    const void *body;
+    size_t grain;
+    std::atomic<size_t> remaining; // Indices not yet run
+    std::atomic<bool> failed;
+    std::exception_ptr error; // Written once, by whoever sets failed
+  };
+
+  struct task {
+    job *owner;
+    size_t lo;
+    size_t hi;
+  };
+
+  // Queue shared by threads outside the pool
+  struct shared_queue {
+    std::mutex lock;
+    deque<task *> tasks;
+  };
+
+  size_t thread_count; // Threads running tasks, the caller included
+  work_stealing_deque<task *> *queues; // One per worker
+  shared_queue outside;                // Queue index thread_count - 1
+  std::thread *workers;       // thread_count - 1 worker threads
+  std::atomic<size_t> queued; // Tasks sitting in any queue
+  std::mutex sleep_lock;      // Guards stopping and idle workers' sleep
+  std::condition_variable wake;
+  bool stopping;
+
+  // Queue of the calling thread: its own if it is a worker of this pool,
+  // otherwise the one shared by outside callers
+  size_t current_queue() const {
+    return current_pool() == this ? current_index() : thread_count - 1;
+  }
+
+  static const work_stealing_pool *&current_pool() {
+    thread_local const work_stealing_pool *pool = nullptr;
+    return pool;
+  }
+
+  static size_t &current_index() {
+    thread_local size_t index = 0;
+    return index;
+  }
+
+  // Per-thread xorshift generator for picking steal victims
+  static size_t next_random() {
+    thread_local size_t state =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+
+  // Tasks are queued by pointer, since work_stealing_deque holds word-sized
+  // elements; the thread that takes a task frees it
+  void push(size_t q, const task &t) {
+    task *p = new task(t);
+    if (q + 1 < thread_count) {
+      queues[q].push(p);
+    } else {
+      std::lock_guard<std::mutex> guard(outside.lock);
+      outside.tasks.push_back(p);
+    }
+    queued.fetch_add(1);
+    // Taking the sleep lock orders this push before any sleeper's check
+    { std::lock_guard<std::mutex> guard(sleep_lock); }
+    wake.notify_one();
+  }
+
+  // Copy out and free a task taken from a queue
+  bool take(task *p, task &t) {
+    t = *p;
+    delete p;
+    queued.fetch_sub(1);
+    return true;
+  }
+
+  bool pop(size_t q, task &t) {
+    task *p;
+    if (q + 1 < thread_count)
+      return queues[q].pop(p) && take(p, t);
+    std::lock_guard<std::mutex> guard(outside.lock);
+    if (outside.tasks.empty())
+      return false;
+    p = outside.tasks.back();
+    outside.tasks.pop_back();
+    return take(p, t);
+  }
+
+  bool steal(size_t q, task &t) {
+    task *p;
+    if (q + 1 < thread_count)
+      return queues[q].steal(p) && take(p, t);
+    std::lock_guard<std::mutex> guard(outside.lock);
+    if (outside.tasks.empty())
+      return false;
+    p = outside.tasks.front();
+    outside.tasks.pop_front();
+    return take(p, t);
+  }
+
+  // Pop from the own queue, else steal from the others starting at a
+  // random victim
+  bool find_task(size_t self, task &t) {
+    if (pop(self, t))
+      return true;
+    size_t start = next_random() % thread_count;
+    for (size_t i = 0; i < thread_count; ++i) {
+      size_t victim = (start + i) % thread_count;
+      if (victim != self && steal(victim, t))
+        return true;
+    }
+    return false;
+  }
+
+  // Run a task, splitting off upper halves for other threads until it is
+  // no larger than the grain
+  void run(size_t self, task t) {
+    job *j = t.owner;
+    while (t.hi - t.lo > j->grain) {
+      size_t mid = t.lo + (t.hi - t.lo) / 2;
+      push(self, task{j, mid, t.hi});
+      t.hi = mid;
+    }
+    try {
+      if (!j->failed.load())
+        j->invoke(j->body, t.lo, t.hi);
+    } catch (...) {
+      if (!j->failed.exchange(true))
+        j->error = std::current_exception();
+    }
+    // The waiting caller may destroy the job once this reaches zero
+    j->remaining.fetch_sub(t.hi - t.lo);
+  }
+
+  void worker_loop(size_t index) {
+    current_pool() = this;
+    current_index() = index;
+    task t;
+    for (;;) {
+      if (find_task(index, t)) {
+        run(index, t);
+        continue;
+      }
+      std::unique_lock<std::mutex> guard(sleep_lock);
+      wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+      if (stopping && queued.load() == 0)
+        return;
+    }
+  }
+
+public:
+  /**
+   * @param threads Number of threads running tasks, counting the thread that
+   * calls parallel_for; threads - 1 workers are started. 0 selects
+   * std::thread::hardware_concurrency().
+   */
+  explicit work_stealing_pool(size_t threads = 0)
+      : thread_count(threads != 0 ? threads
+                                  : std::thread::hardware_concurrency()),
+        queues(nullptr), workers(nullptr), queued(0), stopping(false) {
+    if (thread_count == 0)
+      thread_count = 1;
+    queues = new work_stealing_deque<task *>[thread_count - 1];
+    workers = new std::thread[thread_count - 1];
+    for (size_t i = 0; i + 1 < thread_count; ++i)
+      workers[i] = std::thread(&work_stealing_pool::worker_loop, this, i);
+  }
+
+  work_stealing_pool(const work_stealing_pool &) = delete;
+  work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+
+  ~work_stealing_pool() {
+    {
+      std::lock_guard<std::mutex> guard(sleep_lock);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i + 1 < thread_count; ++i)
+      workers[i].join();
+    delete[] workers;
+    delete[] queues;
+  }
+
+  // Process-wide pool with one thread per hardware thread
+  static work_stealing_pool &shared() {
+    static work_stealing_pool pool;
+    return pool;
+  }
+
+  // Number of threads running tasks, the caller included
+  size_t size() const { return thread_count; }
+
+  /**
+   * Run body(lo, hi) over disjoint ranges covering [0, n), each holding at
+   * most grain indices, and wait for all of them
+   * @param n Number of indices
+   * @param grain Largest range handed to one body call, at least 1
+   * @param body Callable taking (size_t lo, size_t hi), safe to call from
+   * several threads at once
+   */
+  template <class F> void parallel_for(size_t n, size_t grain, const F &body) {
+    if (n == 0)
+      return;
+    if (grain == 0)
+      grain = 1;
+    job j;
+    j.invoke = [](const void *b, size_t lo, size_t hi) {
+      (*static_cast<const F *>(b))(lo, hi);
+    };
+    j.body = &body;
+    j.grain = grain;
+    j.remaining.store(n);
+    j.failed.store(false);
+
+    size_t self = current_queue();
+    run(self, task{&j, 0, n});
+    task t;
+    while (j.remaining.load() != 0) {
+      if (find_task(self, t))
+        run(self, t);
+      else
+        std::this_thread::yield();
+    }
+    if (j.failed.load())
+      std::rethrow_exception(j.error);
+  }
+};
+
+} // namespace sjtu
+
+#endif